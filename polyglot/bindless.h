@@ -0,0 +1,31 @@
+#ifndef RAYMARCHER_BINDLESS_H
+#define RAYMARCHER_BINDLESS_H
+
+// Layout of the global descriptor table, shared so the shaders and raymarcher::core::BindlessTable agree. Shaders
+//  address resources by the table index passed in their push constants instead of by binding point.
+
+#define BINDLESS_STORAGE_IMAGE_BINDING 0
+#define BINDLESS_SAMPLED_IMAGE_BINDING 1
+#define BINDLESS_STORAGE_BUFFER_BINDING 2
+
+#define BINDLESS_MAX_STORAGE_IMAGES 64
+#define BINDLESS_MAX_SAMPLED_IMAGES 64
+#define BINDLESS_MAX_STORAGE_BUFFERS 64
+
+#ifndef __cplusplus
+// runtime sized descriptor arrays. include this file first, extension directives must precede all declarations
+#extension GL_EXT_nonuniform_qualifier : require
+
+// indices come from push constants and are dynamically uniform, so no nonuniformEXT is needed. buffer arrays are
+//  typed per shader, declare them with binding = BINDLESS_STORAGE_BUFFER_BINDING
+layout(binding = BINDLESS_STORAGE_IMAGE_BINDING, rgba8) uniform image2D storageImages[];
+
+// the same storage image array, once per format an image in it may have. loads and stores must use the alias matching
+//  the image's format, see trail.h
+layout(binding = BINDLESS_STORAGE_IMAGE_BINDING, r16f) uniform image2D storageImagesR16f[];
+layout(binding = BINDLESS_STORAGE_IMAGE_BINDING, r32f) uniform image2D storageImagesR32f[];
+layout(binding = BINDLESS_STORAGE_IMAGE_BINDING, r32ui) uniform uimage2D storageImagesR32ui[];
+layout(binding = BINDLESS_SAMPLED_IMAGE_BINDING) uniform sampler2D sampledImages[];
+#endif
+
+#endif  // RAYMARCHER_BINDLESS_H
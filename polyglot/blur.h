@@ -0,0 +1,40 @@
+#ifndef RAYMARCHER_BLUR_H
+#define RAYMARCHER_BLUR_H
+
+#ifdef __cplusplus
+#include <cstddef>
+#endif
+
+// the fused blur keeps a tile plus an apron of this many pixels in shared memory, so the radius has an upper bound.
+//  the weights are computed on the host, weight i applies to the pixels i away from the center on both sides
+#define BLUR_MAX_RADIUS 8
+
+// the box blur runs one workgroup per image row or column, which scans the line in shared memory. the largest
+//  workgroup every device supports
+#define BOX_BLUR_WORKGROUP_SIZE 128
+
+struct BlurPushConsts {
+    // bindless table indices, see bindless.h
+    int readImage;
+    int writeImage;
+    int weightBuffer;  // BLUR_RADIUS + 1 floats, normalized over the full kernel
+};
+
+// one box filter along one axis. repeated passes approximate a Gaussian at a cost that does not depend on the radius
+struct BoxBlurPushConsts {
+    // bindless table indices, see bindless.h
+    int readImage;
+    int writeImage;
+
+    int radius;
+    int vertical;  // 0 filters along rows, 1 along columns
+};
+
+#ifdef __cplusplus
+static_assert(sizeof(BoxBlurPushConsts) == 16 && offsetof(BoxBlurPushConsts, radius) == 8 && offsetof(BoxBlurPushConsts, vertical) == 12,
+              "BoxBlurPushConsts must match its std430 layout");
+static_assert(sizeof(BlurPushConsts) == 12 && offsetof(BlurPushConsts, writeImage) == 4 && offsetof(BlurPushConsts, weightBuffer) == 8,
+              "BlurPushConsts must match its std430 layout");
+#endif
+
+#endif  // RAYMARCHER_BLUR_H
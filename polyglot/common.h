@@ -3,20 +3,24 @@
 
 #ifdef __cplusplus
 
+#include <cstddef>
 #include <glm/glm.hpp>
-using glm::mat4;
 using glm::vec2;
 #endif
 
+// Structs in this file are shared with GLSL, where buffers use std430 and push constants use std430 as well. Keep the
+//  C++ layout identical: std430 rounds a struct's size up to its largest member alignment (8 for vec2, 16 for vec4
+//  and mat4), which C++ does not do for glm types, so pad explicitly. The static_asserts below catch mismatches.
+
 struct Agent {
     vec2 position;
     float angle;
+    float age;  // seconds since the agent was spawned. also pads the std430 array stride to 16
 };
 
-struct ComputePushConsts {
-    mat4 invView;
-    mat4 invProj;
-    float deltaTime;
-};
+#ifdef __cplusplus
+static_assert(sizeof(Agent) == 16, "Agent must match its std430 array stride");
+static_assert(offsetof(Agent, position) == 0 && offsetof(Agent, angle) == 8, "Agent members must match std430 offsets");
+#endif
 
 #endif  // RAYMARCH_TONEMAPPING_H
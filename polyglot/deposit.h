@@ -0,0 +1,32 @@
+#ifndef RAYMARCHER_DEPOSIT_H
+#define RAYMARCHER_DEPOSIT_H
+
+#ifdef __cplusplus
+#include <cstddef>
+#endif
+
+// How drawagents leaves the agents in the trail map, chosen on the host and passed as SPEC_ID_DEPOSIT_MODE.
+//  STORE writes 1.0 into the trail, so agents sharing a pixel count once. ATOMIC and HISTOGRAM count every agent in
+//  a R32_UINT deposit image with imageAtomicAdd, and a resolve pass adds the counts to the trail map and clears them.
+
+#define DEPOSIT_MODE_STORE 0
+#define DEPOSIT_MODE_ATOMIC 1
+#define DEPOSIT_MODE_HISTOGRAM 2  // agents of one workgroup are counted in shared memory first, see drawagents.comp.glsl
+
+// how many slots an agent tries in its workgroup's histogram before it deposits straight into the image
+#define DEPOSIT_HISTOGRAM_PROBES 4
+
+// what one agent adds to its pixel, in the fixed point units of TRAIL_FIXED_POINT_SCALE, so 1.0 per agent
+#define DEPOSIT_UNITS 65536u
+
+struct DepositPushConsts {
+    // bindless table indices, see bindless.h
+    int trailImage;
+    int depositImage;
+};
+
+#ifdef __cplusplus
+static_assert(sizeof(DepositPushConsts) == 8 && offsetof(DepositPushConsts, depositImage) == 4, "DepositPushConsts must match its std430 layout");
+#endif
+
+#endif  // RAYMARCHER_DEPOSIT_H
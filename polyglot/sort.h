@@ -0,0 +1,52 @@
+#ifndef RAYMARCHER_SORT_H
+#define RAYMARCHER_SORT_H
+
+#ifdef __cplusplus
+#include <cstddef>
+#endif
+
+// Agents are reordered by the Morton code of the cell they are in, so neighboring invocations of update and
+//  drawagents touch neighboring pixels. The key has a single radix digit of SORT_KEY_BITS, so the sort is one counting
+//  pass: count the agents per cell, scan the counts into offsets, scatter the agents to their offsets.
+
+#define SORT_GRID_BITS 6  // the image is split into 2^SORT_GRID_BITS cells along each axis
+#define SORT_KEY_BITS (2 * SORT_GRID_BITS)
+#define SORT_CELLS (1 << SORT_KEY_BITS)
+
+// the largest workgroup every device supports. the scan runs as one workgroup, each invocation covers several cells.
+//  counting and scattering run with the agent workgroup size, through the population's dispatch arguments
+#define SORT_WORKGROUP_SIZE 128
+
+struct SortPushConsts {
+    int width;  // size of the trail map, which the cells split up
+    int height;
+    int scatter;  // 0 counts the agents per cell, 1 scatters them to the offsets the scan left
+
+    // bindless table indices, see bindless.h
+    int populationBuffer;  // the agent count, see update.h
+    int agentBuffer;
+    int sortedBuffer;  // the other agent buffer
+    int cellBuffer;  // SORT_CELLS counts, which the scan turns into offsets
+};
+
+#ifdef __cplusplus
+static_assert(sizeof(SortPushConsts) == 28 && offsetof(SortPushConsts, scatter) == 8 && offsetof(SortPushConsts, populationBuffer) == 12
+              && offsetof(SortPushConsts, cellBuffer) == 24, "SortPushConsts must match its std430 layout");
+#else
+// spreads the low SORT_GRID_BITS bits of v to the even bits
+uint spreadBits(uint v) {
+    v &= 0x0000FFFFu;
+    v = (v | (v << 8)) & 0x00FF00FFu;
+    v = (v | (v << 4)) & 0x0F0F0F0Fu;
+    v = (v | (v << 2)) & 0x33333333u;
+    v = (v | (v << 1)) & 0x55555555u;
+    return v;
+}
+
+uint sortKey(vec2 position, ivec2 size) {
+    uvec2 cell = uvec2(clamp(ivec2(position * float(1 << SORT_GRID_BITS) / vec2(size)), ivec2(0), ivec2((1 << SORT_GRID_BITS) - 1)));
+    return spreadBits(cell.x) | (spreadBits(cell.y) << 1);
+}
+#endif
+
+#endif  // RAYMARCHER_SORT_H
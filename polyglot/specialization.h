@@ -0,0 +1,15 @@
+#ifndef RAYMARCHER_SPECIALIZATION_H
+#define RAYMARCHER_SPECIALIZATION_H
+
+// Specialization constant IDs, shared so the shaders and raymarcher::core::SpecializationConstants agree
+
+#define SPEC_ID_LOCAL_SIZE_X 0
+#define SPEC_ID_LOCAL_SIZE_Y 1
+#define SPEC_ID_AGENT_SPEED 2
+#define SPEC_ID_BLUR_RADIUS 3
+#define SPEC_ID_BOX_BLUR_LINE 4
+#define SPEC_ID_TRAIL_FORMAT 5
+#define SPEC_ID_DEPOSIT_MODE 6
+#define SPEC_ID_AGENT_LIFETIME 7
+
+#endif  // RAYMARCHER_SPECIALIZATION_H
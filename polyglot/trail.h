@@ -0,0 +1,65 @@
+#ifndef RAYMARCHER_TRAIL_H
+#define RAYMARCHER_TRAIL_H
+
+#ifdef __cplusplus
+#include <cstddef>
+#endif
+
+// The trail map is a single channel image in one of these formats, chosen on the host and passed to the shaders as
+//  the SPEC_ID_TRAIL_FORMAT specialization constant. Shaders only go through loadTrail() and storeTrail() below, the
+//  branches on the format are folded away when the pipeline is created.
+
+#define TRAIL_FORMAT_R16F 0
+#define TRAIL_FORMAT_R32F 1
+#define TRAIL_FORMAT_R32UI 2
+
+// R32UI trails hold fixed point values, 1.0 is stored as this many units
+#define TRAIL_FIXED_POINT_SCALE 65536.0
+
+// accumulated deposits are clamped to this, which every trail format can hold
+#define TRAIL_MAX_VALUE 32768.0
+
+struct DisplayPushConsts {
+    // bindless table indices, see bindless.h
+    int trailImage;
+    int displayImage;
+};
+
+#ifdef __cplusplus
+static_assert(sizeof(DisplayPushConsts) == 8 && offsetof(DisplayPushConsts, displayImage) == 4, "DisplayPushConsts must match its std430 layout");
+#else
+// expects bindless.h and specialization.h to be included
+layout (constant_id = SPEC_ID_TRAIL_FORMAT) const int TRAIL_FORMAT = TRAIL_FORMAT_R16F;
+
+ivec2 trailSize(int image) {
+    if (TRAIL_FORMAT == TRAIL_FORMAT_R32UI) {
+        return imageSize(storageImagesR32ui[image]);
+    } else if (TRAIL_FORMAT == TRAIL_FORMAT_R32F) {
+        return imageSize(storageImagesR32f[image]);
+    }
+
+    return imageSize(storageImagesR16f[image]);
+}
+
+float loadTrail(int image, ivec2 pix) {
+    if (TRAIL_FORMAT == TRAIL_FORMAT_R32UI) {
+        return float(imageLoad(storageImagesR32ui[image], pix).r) / TRAIL_FIXED_POINT_SCALE;
+    } else if (TRAIL_FORMAT == TRAIL_FORMAT_R32F) {
+        return imageLoad(storageImagesR32f[image], pix).r;
+    }
+
+    return imageLoad(storageImagesR16f[image], pix).r;
+}
+
+void storeTrail(int image, ivec2 pix, float value) {
+    if (TRAIL_FORMAT == TRAIL_FORMAT_R32UI) {
+        imageStore(storageImagesR32ui[image], pix, uvec4(uint(max(value, 0.0) * TRAIL_FIXED_POINT_SCALE + 0.5)));
+    } else if (TRAIL_FORMAT == TRAIL_FORMAT_R32F) {
+        imageStore(storageImagesR32f[image], pix, vec4(value));
+    } else {
+        imageStore(storageImagesR16f[image], pix, vec4(value));
+    }
+}
+#endif
+
+#endif  // RAYMARCHER_TRAIL_H
@@ -2,11 +2,70 @@
 #define RAYMARCHER_UPDATE_H
 
 #ifdef __cplusplus
+#include <cstddef>
+#include <cstdint>
+using uint = uint32_t;
 #endif
 
+// The agent count lives on the GPU. update appends the agents that survive and the ones it spawns to the other agent
+//  buffer, and the population pass turns the count into the dispatch arguments of the passes that follow, so agents
+//  come and go without the host ever reading the count.
+
+#define POPULATION_BEGIN_STEP 0  // picks how many agents to spawn, and sizes the update dispatch
+#define POPULATION_END_STEP 1  // takes over the count update appended, and sizes the dispatches after it
+
+// Agent passes are dispatched over a 2D grid of workgroups, so large populations stay within
+//  maxComputeWorkGroupCount[0]: rows of at most maxGroupsX workgroups, as many rows as needed. AGENT_INDEX flattens
+//  an invocation back to its agent.
+
+struct AgentPopulation {
+    // VkDispatchIndirectCommand, covering the agents of the next agent pass, see population.comp.glsl
+    uint dispatchX;
+    uint dispatchY;
+    uint dispatchZ;
+
+    uint count;  // agents in the current agent buffer
+    uint spawnCount;  // agents update spawns this step, after the count ones it updates
+    uint nextCount;  // agents update has appended to the other buffer so far
+};
+
 struct UpdatePushConsts {
-    int agentCount;
     float deltaTime;
+    uint seed;  // changes every step, so spawned agents differ
+
+    // bindless table indices, see bindless.h
+    int readImage;
+    int writeImage;
+    int agentBuffer;
+    int nextAgentBuffer;  // where update appends, unused by drawagents
+    int populationBuffer;
 };
 
+struct PopulationPushConsts {
+    int populationBuffer;  // bindless table index, see bindless.h
+    int stage;  // POPULATION_BEGIN_STEP or POPULATION_END_STEP
+    uint spawnRate;  // agents spawned per step while below capacity
+    uint capacity;  // agents each agent buffer holds
+    uint maxGroupsX;  // workgroups per dispatch row, at most the device's maxComputeWorkGroupCount[0]
+};
+
+#ifdef __cplusplus
+static_assert(sizeof(AgentPopulation) == 24 && offsetof(AgentPopulation, dispatchX) == 0 && offsetof(AgentPopulation, count) == 12
+              && offsetof(AgentPopulation, nextCount) == 20, "AgentPopulation must match its std430 layout");
+static_assert(sizeof(UpdatePushConsts) == 28 && offsetof(UpdatePushConsts, seed) == 4 && offsetof(UpdatePushConsts, readImage) == 8
+              && offsetof(UpdatePushConsts, agentBuffer) == 16 && offsetof(UpdatePushConsts, populationBuffer) == 24, "UpdatePushConsts must match its std430 layout");
+static_assert(sizeof(PopulationPushConsts) == 20 && offsetof(PopulationPushConsts, stage) == 4 && offsetof(PopulationPushConsts, capacity) == 12
+              && offsetof(PopulationPushConsts, maxGroupsX) == 16,
+              "PopulationPushConsts must match its std430 layout");
+#else
+// expects bindless.h to be included
+layout(std430, binding = BINDLESS_STORAGE_BUFFER_BINDING) buffer PopulationBuffer {
+    AgentPopulation population;
+} populationBuffers[];
+
+// the agent an invocation of an agent pass covers, past the population's count in the last row. a macro, because
+//  gl_WorkGroupSize is only usable after the including shader has declared its local size
+#define AGENT_INDEX (gl_GlobalInvocationID.y * gl_NumWorkGroups.x * gl_WorkGroupSize.x + gl_GlobalInvocationID.x)
+#endif
+
 #endif  // RAYMARCHER_UPDATE_H
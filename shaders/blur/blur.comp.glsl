@@ -1,23 +1,68 @@
-layout(binding = 0, rgba8) readonly  uniform image2D readImage;
-layout(binding = 1, rgba8) writeonly uniform image2D writeImage;
-
-//-----------------------------------------------------------------------------
-// 1‑D Gaussian blur along an arbitrary axis (dir = (1,0) for X, (0,1) for Y)
-//-----------------------------------------------------------------------------
-vec4 gaussianBlur1D(ivec2 pix, ivec2 size, float sigma, ivec2 dir) {
-    int   radius       = int(ceil(3.0 * sigma));
-    float invTwoSigma2 = 1.0 / (2.0 * sigma * sigma);
-    float norm         = 1.0 / (sqrt(2.0 * 3.14159265) * sigma);
-
-    vec4  colSum = vec4(0.0);
-    float wSum   = 0.0;
-
-    for (int offset = -radius; offset <= radius; ++offset) {
-        ivec2 samplePix = clamp(pix + dir * offset, ivec2(0), size - 1);
-        float w = norm * exp(-float(offset * offset) * invTwoSigma2);
-        colSum += imageLoad(readImage, samplePix) * w;
-        wSum  += w;
+#version 460
+
+#include "bindless.h"
+#include "blur.h"
+#include "specialization.h"
+#include "trail.h"
+
+layout (push_constant) uniform PushConsts {
+    BlurPushConsts pushConstants;
+};
+
+// workgroup size and radius are specialized from C++, see Raymarcher.cpp
+layout (local_size_x_id = SPEC_ID_LOCAL_SIZE_X, local_size_y_id = SPEC_ID_LOCAL_SIZE_Y, local_size_z = 1) in;
+layout (constant_id = SPEC_ID_BLUR_RADIUS) const uint BLUR_RADIUS = 2;
+
+layout(std430, binding = BINDLESS_STORAGE_BUFFER_BINDING) readonly buffer BlurWeights {
+    float weights[];
+} weightBuffers[];
+
+// the workgroup's pixels plus BLUR_RADIUS on every side
+const uint TILE_WIDTH = gl_WorkGroupSize.x + 2 * BLUR_RADIUS;
+const uint TILE_HEIGHT = gl_WorkGroupSize.y + 2 * BLUR_RADIUS;
+shared float tile[TILE_WIDTH * TILE_HEIGHT];
+
+// the horizontal pass over every tile row, apron rows included, so the vertical pass never leaves shared memory
+shared float horizontal[gl_WorkGroupSize.x * TILE_HEIGHT];
+
+void main() {
+    ivec2 size = trailSize(pushConstants.readImage);
+    ivec2 origin = ivec2(gl_WorkGroupID.xy * gl_WorkGroupSize.xy) - ivec2(BLUR_RADIUS);
+    uint groupSize = gl_WorkGroupSize.x * gl_WorkGroupSize.y;
+
+    // every texel of the tile is loaded once, clamped to the edge
+    for (uint i = gl_LocalInvocationIndex; i < TILE_WIDTH * TILE_HEIGHT; i += groupSize) {
+        ivec2 texel = clamp(origin + ivec2(i % TILE_WIDTH, i / TILE_WIDTH), ivec2(0), size - 1);
+        tile[i] = loadTrail(pushConstants.readImage, texel);
+    }
+
+    barrier();
+
+    for (uint i = gl_LocalInvocationIndex; i < gl_WorkGroupSize.x * TILE_HEIGHT; i += groupSize) {
+        uint center = (i / gl_WorkGroupSize.x) * TILE_WIDTH + i % gl_WorkGroupSize.x + BLUR_RADIUS;
+
+        float sum = tile[center] * weightBuffers[pushConstants.weightBuffer].weights[0];
+        for (uint r = 1; r <= BLUR_RADIUS; r++) {
+            sum += (tile[center - r] + tile[center + r]) * weightBuffers[pushConstants.weightBuffer].weights[r];
+        }
+
+        horizontal[i] = sum;
+    }
+
+    barrier();
+
+    // only return after the last barrier, edge workgroups still help filling the tile
+    ivec2 pix = ivec2(gl_GlobalInvocationID.xy);
+    if (any(greaterThanEqual(pix, size))) {
+        return;
+    }
+
+    uint center = (gl_LocalInvocationID.y + BLUR_RADIUS) * gl_WorkGroupSize.x + gl_LocalInvocationID.x;
+
+    float sum = horizontal[center] * weightBuffers[pushConstants.weightBuffer].weights[0];
+    for (uint r = 1; r <= BLUR_RADIUS; r++) {
+        sum += (horizontal[center - r * gl_WorkGroupSize.x] + horizontal[center + r * gl_WorkGroupSize.x]) * weightBuffers[pushConstants.weightBuffer].weights[r];
     }
 
-    return colSum / wSum;
+    storeTrail(pushConstants.writeImage, pix, sum);
 }
@@ -0,0 +1,89 @@
+#version 460
+
+#include "bindless.h"
+#include "blur.h"
+#include "specialization.h"
+#include "trail.h"
+
+layout (push_constant) uniform PushConsts {
+    BoxBlurPushConsts pushConstants;
+};
+
+// one workgroup per image row or column
+layout (local_size_x = BOX_BLUR_WORKGROUP_SIZE, local_size_y = 1, local_size_z = 1) in;
+
+// the longest line, specialized from C++ so shared memory fits the image, see Raymarcher.cpp
+layout (constant_id = SPEC_ID_BOX_BLUR_LINE) const int MAX_LINE = 1024;
+
+// prefix[i] sums the first i pixels of the line, so every window costs two loads whatever the radius
+shared float prefix[MAX_LINE + 1];
+shared float sums[BOX_BLUR_WORKGROUP_SIZE];
+
+void main() {
+    ivec2 size = trailSize(pushConstants.readImage);
+    bool vertical = pushConstants.vertical != 0;
+
+    int line = int(gl_WorkGroupID.x);
+    int len = vertical ? size.y : size.x;
+    ivec2 dir = vertical ? ivec2(0, 1) : ivec2(1, 0);
+    ivec2 start = vertical ? ivec2(line, 0) : ivec2(0, line);
+    uint invocation = gl_LocalInvocationIndex;
+
+    // neighboring invocations load neighboring pixels
+    for (int i = int(invocation); i < len; i += BOX_BLUR_WORKGROUP_SIZE) {
+        prefix[i + 1] = loadTrail(pushConstants.readImage, start + dir * i);
+    }
+
+    if (invocation == 0) {
+        prefix[0] = 0.0;
+    }
+
+    barrier();
+
+    // each invocation sums a contiguous segment, and the segment totals are scanned like in scan.comp
+    int segment = (len + BOX_BLUR_WORKGROUP_SIZE - 1) / BOX_BLUR_WORKGROUP_SIZE;
+    int first = int(invocation) * segment;
+    int last = min(first + segment, len);
+
+    float total = 0.0;
+    for (int i = first; i < last; i++) {
+        total += prefix[i + 1];
+    }
+
+    sums[invocation] = total;
+    barrier();
+
+    // inclusive Hillis-Steele scan over the segment totals
+    for (uint offset = 1; offset < BOX_BLUR_WORKGROUP_SIZE; offset *= 2) {
+        float value = invocation >= offset ? sums[invocation - offset] : 0.0;
+        barrier();
+
+        sums[invocation] += value;
+        barrier();
+    }
+
+    // turn the segment into prefix sums in place
+    float running = sums[invocation] - total;
+    for (int i = first; i < last; i++) {
+        running += prefix[i + 1];
+        prefix[i + 1] = running;
+    }
+
+    barrier();
+
+    // the window is clamped to the edge, so pixels past either end repeat the edge pixel
+    int radius = pushConstants.radius;
+    float scale = 1.0 / float(2 * radius + 1);
+    float firstPixel = prefix[1];
+    float lastPixel = prefix[len] - prefix[len - 1];
+
+    for (int i = int(invocation); i < len; i += BOX_BLUR_WORKGROUP_SIZE) {
+        int lo = i - radius;
+        int hi = i + radius;
+
+        float sum = prefix[min(hi, len - 1) + 1] - prefix[max(lo, 0)];
+        sum += float(max(-lo, 0)) * firstPixel + float(max(hi - (len - 1), 0)) * lastPixel;
+
+        storeTrail(pushConstants.writeImage, start + dir * i, sum * scale);
+    }
+}
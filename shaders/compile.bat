@@ -1,7 +1,12 @@
 glslc -O -I "../polyglot" -fshader-stage=vert --target-env=vulkan1.3 ./raster/display.vert.glsl -o ./raster/display.vert.spv
 glslc -O -I "../polyglot" -fshader-stage=frag --target-env=vulkan1.3 ./raster/display.frag.glsl -o ./raster/display.frag.spv
 
-glslc -O -I "../polyglot" -fshader-stage=comp --target-env=vulkan1.3 ./blur/blurx.comp.glsl -o ./blur/blurx.comp.spv
-glslc -O -I "../polyglot" -fshader-stage=comp --target-env=vulkan1.3 ./blur/blury.comp.glsl -o ./blur/blury.comp.spv
+glslc -O -I "../polyglot" -fshader-stage=comp --target-env=vulkan1.3 ./blur/blur.comp.glsl -o ./blur/blur.comp.spv
+glslc -O -I "../polyglot" -fshader-stage=comp --target-env=vulkan1.3 ./blur/boxblur.comp.glsl -o ./blur/boxblur.comp.spv
 glslc -O -I "../polyglot" -fshader-stage=comp --target-env=vulkan1.3 ./update/update.comp.glsl -o ./update/update.comp.spv
 glslc -O -I "../polyglot" -fshader-stage=comp --target-env=vulkan1.3 ./update/drawagents.comp.glsl -o ./update/drawagents.comp.spv
+glslc -O -I "../polyglot" -fshader-stage=comp --target-env=vulkan1.3 ./update/population.comp.glsl -o ./update/population.comp.spv
+glslc -O -I "../polyglot" -fshader-stage=comp --target-env=vulkan1.3 ./update/resolvedeposits.comp.glsl -o ./update/resolvedeposits.comp.spv
+glslc -O -I "../polyglot" -fshader-stage=comp --target-env=vulkan1.3 ./sort/morton.comp.glsl -o ./sort/morton.comp.spv
+glslc -O -I "../polyglot" -fshader-stage=comp --target-env=vulkan1.3 ./sort/scan.comp.glsl -o ./sort/scan.comp.spv
+glslc -O -I "../polyglot" -fshader-stage=comp --target-env=vulkan1.3 ./display/colorize.comp.glsl -o ./display/colorize.comp.spv
@@ -0,0 +1,26 @@
+#version 460
+
+#include "bindless.h"
+#include "specialization.h"
+#include "trail.h"
+
+layout (push_constant) uniform PushConsts {
+    DisplayPushConsts pushConstants;
+};
+
+// workgroup size is specialized from C++, see Raymarcher.cpp
+layout (local_size_x_id = SPEC_ID_LOCAL_SIZE_X, local_size_y_id = SPEC_ID_LOCAL_SIZE_Y, local_size_z = 1) in;
+
+void main() {
+    ivec2 pix = ivec2(gl_GlobalInvocationID.xy);
+    if (any(greaterThanEqual(pix, trailSize(pushConstants.trailImage)))) {
+        return;
+    }
+
+    // trails above 1 saturate to white, faint ones fade through teal into the background
+    float trail = clamp(loadTrail(pushConstants.trailImage, pix), 0.0, 1.0);
+    vec3 background = vec3(0.01, 0.01, 0.03);
+    vec3 color = trail < 0.5 ? mix(background, vec3(0.05, 0.55, 0.6), trail * 2.0) : mix(vec3(0.05, 0.55, 0.6), vec3(1.0), trail * 2.0 - 1.0);
+
+    imageStore(storageImages[pushConstants.displayImage], pix, vec4(color, 1.0));
+}
@@ -0,0 +1,41 @@
+#version 460
+
+#include "bindless.h"
+#include "common.h"
+#include "update.h"
+#include "specialization.h"
+#include "sort.h"
+
+layout (push_constant) uniform PushConsts {
+    SortPushConsts pushConstants;
+};
+
+// dispatched through the population's arguments, so it shares the agent workgroup size, see Raymarcher.cpp
+layout (local_size_x_id = SPEC_ID_LOCAL_SIZE_X, local_size_y = 1, local_size_z = 1) in;
+
+layout(std430, binding = BINDLESS_STORAGE_BUFFER_BINDING) buffer AgentBuffer {
+    Agent agents[];
+} agentBuffers[];
+
+layout(std430, binding = BINDLESS_STORAGE_BUFFER_BINDING) buffer CellBuffer {
+    uint cells[];
+} cellBuffers[];
+
+void main() {
+    uint agentID = AGENT_INDEX;
+    if (agentID >= populationBuffers[pushConstants.populationBuffer].population.count) {
+        return;
+    }
+
+    Agent agent = agentBuffers[pushConstants.agentBuffer].agents[agentID];
+    uint key = sortKey(agent.position, ivec2(pushConstants.width, pushConstants.height));
+
+    if (pushConstants.scatter == 0) {
+        atomicAdd(cellBuffers[pushConstants.cellBuffer].cells[key], 1u);
+        return;
+    }
+
+    // agents within a cell end up in no particular order, which does not matter for locality
+    uint destination = atomicAdd(cellBuffers[pushConstants.cellBuffer].cells[key], 1u);
+    agentBuffers[pushConstants.sortedBuffer].agents[destination] = agent;
+}
@@ -0,0 +1,48 @@
+#version 460
+
+#include "bindless.h"
+#include "sort.h"
+
+layout (push_constant) uniform PushConsts {
+    SortPushConsts pushConstants;
+};
+
+// a single workgroup scans every cell
+layout (local_size_x = SORT_WORKGROUP_SIZE, local_size_y = 1, local_size_z = 1) in;
+
+layout(std430, binding = BINDLESS_STORAGE_BUFFER_BINDING) buffer CellBuffer {
+    uint cells[];
+} cellBuffers[];
+
+const uint CELLS_PER_INVOCATION = SORT_CELLS / SORT_WORKGROUP_SIZE;
+
+shared uint sums[SORT_WORKGROUP_SIZE];
+
+void main() {
+    uint first = gl_LocalInvocationIndex * CELLS_PER_INVOCATION;
+
+    uint total = 0;
+    for (uint i = 0; i < CELLS_PER_INVOCATION; i++) {
+        total += cellBuffers[pushConstants.cellBuffer].cells[first + i];
+    }
+
+    sums[gl_LocalInvocationIndex] = total;
+    barrier();
+
+    // inclusive Hillis-Steele scan over the per invocation totals
+    for (uint offset = 1; offset < SORT_WORKGROUP_SIZE; offset *= 2) {
+        uint value = gl_LocalInvocationIndex >= offset ? sums[gl_LocalInvocationIndex - offset] : 0;
+        barrier();
+
+        sums[gl_LocalInvocationIndex] += value;
+        barrier();
+    }
+
+    // turn the counts into exclusive offsets in place
+    uint offset = sums[gl_LocalInvocationIndex] - total;
+    for (uint i = 0; i < CELLS_PER_INVOCATION; i++) {
+        uint count = cellBuffers[pushConstants.cellBuffer].cells[first + i];
+        cellBuffers[pushConstants.cellBuffer].cells[first + i] = offset;
+        offset += count;
+    }
+}
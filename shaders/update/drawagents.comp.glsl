@@ -1,37 +1,94 @@
 #version 460
 
+#include "bindless.h"
 #include "common.h"
 #include "update.h"
+#include "specialization.h"
+#include "trail.h"
+#include "deposit.h"
 
 layout (push_constant) uniform PushConsts {
     UpdatePushConsts pushConstants;
 };
 
-layout (local_size_x = 32, local_size_y = 8, local_size_z = 1) in;
+// agents are processed in rows of 1D workgroups, see AGENT_INDEX. the workgroup size is specialized from C++, see
+//  Raymarcher.cpp
+layout (local_size_x_id = SPEC_ID_LOCAL_SIZE_X, local_size_y = 1, local_size_z = 1) in;
+layout (constant_id = SPEC_ID_DEPOSIT_MODE) const int DEPOSIT_MODE = DEPOSIT_MODE_STORE;
 
-layout(binding = 0, rgba8) writeonly uniform image2D readImage;
-layout(binding = 1, rgba8) writeonly uniform image2D writeImage;
-
-layout(std430, binding = 2) buffer AgentBuffer {
+layout(std430, binding = BINDLESS_STORAGE_BUFFER_BINDING) buffer AgentBuffer {
     Agent agents[];
-};
+} agentBuffers[];
 
-void main() {
-    // Get the global pixel coordinate for this invocation
-    uint agentID = gl_GlobalInvocationID.x;
-    if (agentID >= pushConstants.agentCount) {
-        return; // Out of bounds, skip this invocation
+// open addressed table of the pixels this workgroup's agents landed on, one slot per invocation. agents that follow
+//  the same trail share pixels, and each shared pixel costs one global atomic per workgroup instead of one per agent
+const uint EMPTY_SLOT = 0xFFFFFFFFu;
+shared uint slotPixels[gl_WorkGroupSize.x];
+shared uint slotDeposits[gl_WorkGroupSize.x];
+
+void depositHistogram(bool valid, ivec2 pixel, ivec2 size) {
+    slotPixels[gl_LocalInvocationIndex] = EMPTY_SLOT;
+    slotDeposits[gl_LocalInvocationIndex] = 0;
+
+    barrier();
+
+    if (valid) {
+        uint key = uint(pixel.y) * uint(size.x) + uint(pixel.x);
+        uint slot = ((key * 2654435761u) >> 16) % gl_WorkGroupSize.x;
+        bool binned = false;
+
+        for (uint probe = 0; probe < DEPOSIT_HISTOGRAM_PROBES && !binned; probe++) {
+            uint previous = atomicCompSwap(slotPixels[slot], EMPTY_SLOT, key);
+
+            if (previous == EMPTY_SLOT || previous == key) {
+                atomicAdd(slotDeposits[slot], DEPOSIT_UNITS);
+                binned = true;
+            }
+
+            slot = (slot + 1) % gl_WorkGroupSize.x;
+        }
+
+        // the table is crowded around this slot, deposit directly
+        if (!binned) {
+            imageAtomicAdd(storageImagesR32ui[pushConstants.writeImage], pixel, DEPOSIT_UNITS);
+        }
     }
 
-    Agent agent = agents[agentID];
+    barrier();
 
-    ivec2 pixel = ivec2(agent.position);
-    ivec2 imageSize = imageSize(writeImage);
+    // every invocation flushes one slot
+    uint key = slotPixels[gl_LocalInvocationIndex];
+    if (key != EMPTY_SLOT) {
+        imageAtomicAdd(storageImagesR32ui[pushConstants.writeImage], ivec2(key % uint(size.x), key / uint(size.x)), slotDeposits[gl_LocalInvocationIndex]);
+    }
+}
+
+void main() {
+    // writeImage is the trail map when storing, and the deposit image otherwise
+    uint agentID = AGENT_INDEX;
+    ivec2 size = DEPOSIT_MODE == DEPOSIT_MODE_STORE ? trailSize(pushConstants.writeImage) : imageSize(storageImagesR32ui[pushConstants.writeImage]);
 
-    if (pixel.x < 0 || pixel.x >= imageSize.x || pixel.y < 0 || pixel.y >= imageSize.y) {
-        return; // Skip if the pixel is out of bounds
+    // agents past the end or off the image deposit nothing, but still take part in the histogram's barriers
+    bool valid = agentID < populationBuffers[pushConstants.populationBuffer].population.count;
+    ivec2 pixel = ivec2(0);
+
+    if (valid) {
+        pixel = ivec2(agentBuffers[pushConstants.agentBuffer].agents[agentID].position);
+        valid = all(greaterThanEqual(pixel, ivec2(0))) && all(lessThan(pixel, size));
     }
 
-    vec4 color = vec4(1, 1, 1, 1);
-    imageStore(readImage, pixel, color);
-}
\ No newline at end of file
+    if (DEPOSIT_MODE == DEPOSIT_MODE_HISTOGRAM) {
+        depositHistogram(valid, pixel, size);
+        return;
+    }
+
+    if (!valid) {
+        return;
+    }
+
+    if (DEPOSIT_MODE == DEPOSIT_MODE_ATOMIC) {
+        imageAtomicAdd(storageImagesR32ui[pushConstants.writeImage], pixel, DEPOSIT_UNITS);
+    } else {
+        storeTrail(pushConstants.writeImage, pixel, 1.0);
+    }
+}
@@ -0,0 +1,40 @@
+#version 460
+
+#include "bindless.h"
+#include "common.h"
+#include "update.h"
+#include "specialization.h"
+
+layout (push_constant) uniform PushConsts {
+    PopulationPushConsts pushConstants;
+};
+
+// a single invocation. the agent passes' workgroup size is needed to size their dispatches
+layout (local_size_x = 1, local_size_y = 1, local_size_z = 1) in;
+layout (constant_id = SPEC_ID_LOCAL_SIZE_X) const uint AGENT_WORKGROUP_SIZE = 256;
+
+// rows of at most maxGroupsX workgroups, see update.h. the host checked that a full buffer fits in the Y limit
+void agentDispatch(inout AgentPopulation population, uint agents) {
+    uint groups = (agents + AGENT_WORKGROUP_SIZE - 1) / AGENT_WORKGROUP_SIZE;
+
+    population.dispatchX = min(groups, pushConstants.maxGroupsX);
+    population.dispatchY = (groups + pushConstants.maxGroupsX - 1) / pushConstants.maxGroupsX;
+    population.dispatchZ = 1;
+}
+
+void main() {
+    AgentPopulation population = populationBuffers[pushConstants.populationBuffer].population;
+
+    if (pushConstants.stage == POPULATION_BEGIN_STEP) {
+        // the survivors and spawned agents never outgrow the next buffer
+        population.spawnCount = min(pushConstants.spawnRate, pushConstants.capacity - min(population.count, pushConstants.capacity));
+        population.nextCount = 0;
+        agentDispatch(population, population.count + population.spawnCount);
+    } else {
+        population.count = population.nextCount;
+        population.spawnCount = 0;
+        agentDispatch(population, population.count);
+    }
+
+    populationBuffers[pushConstants.populationBuffer].population = population;
+}
@@ -0,0 +1,32 @@
+#version 460
+
+#include "bindless.h"
+#include "specialization.h"
+#include "trail.h"
+#include "deposit.h"
+
+layout (push_constant) uniform PushConsts {
+    DepositPushConsts pushConstants;
+};
+
+// workgroup size is specialized from C++, see Raymarcher.cpp
+layout (local_size_x_id = SPEC_ID_LOCAL_SIZE_X, local_size_y_id = SPEC_ID_LOCAL_SIZE_Y, local_size_z = 1) in;
+
+void main() {
+    ivec2 pix = ivec2(gl_GlobalInvocationID.xy);
+    if (any(greaterThanEqual(pix, trailSize(pushConstants.trailImage)))) {
+        return;
+    }
+
+    // most pixels have no agent on them, those leave the trail map alone
+    uint deposited = imageLoad(storageImagesR32ui[pushConstants.depositImage], pix).r;
+    if (deposited == 0) {
+        return;
+    }
+
+    // clear for the next step's drawagents
+    imageStore(storageImagesR32ui[pushConstants.depositImage], pix, uvec4(0));
+
+    float trail = loadTrail(pushConstants.trailImage, pix) + float(deposited) / TRAIL_FIXED_POINT_SCALE;
+    storeTrail(pushConstants.trailImage, pix, min(trail, TRAIL_MAX_VALUE));
+}
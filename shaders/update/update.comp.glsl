@@ -1,37 +1,96 @@
 #version 460
 
+#include "bindless.h"
 #include "common.h"
 #include "update.h"
+#include "specialization.h"
+#include "trail.h"
 
 layout (push_constant) uniform PushConsts {
     UpdatePushConsts pushConstants;
 };
 
-layout (local_size_x = 32, local_size_y = 8, local_size_z = 1) in;
+// agents are processed in rows of 1D workgroups, see AGENT_INDEX. the workgroup size is specialized from C++, see
+//  Raymarcher.cpp
+layout (local_size_x_id = SPEC_ID_LOCAL_SIZE_X, local_size_y = 1, local_size_z = 1) in;
 
-layout(binding = 0, rgba8) readonly uniform image2D readImage;
-
-layout(std430, binding = 1) buffer AgentBuffer {
+layout(std430, binding = BINDLESS_STORAGE_BUFFER_BINDING) buffer AgentBuffer {
     Agent agents[];
-};
+} agentBuffers[];
+
+layout (constant_id = SPEC_ID_AGENT_SPEED) const float SPEED = 30.0;
+layout (constant_id = SPEC_ID_AGENT_LIFETIME) const float LIFETIME = 0.0;  // seconds, 0 lets agents live forever
+
+// survivors are appended per workgroup: one global atomic reserves the group's range, so agents that were next to
+//  each other stay close in the next buffer, which keeps the order the sort left
+shared uint groupCount;
+shared uint groupBase;
+
+// PCG hash, for spawning agents without a random state
+uint hash(uint v) {
+    uint state = v * 747796405u + 2891336453u;
+    uint word = ((state >> ((state >> 28u) + 4u)) ^ state) * 277803737u;
+    return (word >> 22u) ^ word;
+}
 
-const float SPEED = 30.0;
+// anywhere on the image, so large populations spawned at once do not all share one pixel
+Agent spawnAgent(uint id, vec2 size) {
+    uint h = hash(id ^ hash(pushConstants.seed));
+    uint hx = hash(h);
+    uint hy = hash(hx);
+
+    Agent agent;
+    agent.position = vec2(hx, hy) / 4294967295.0 * (size - 1.0);
+    agent.angle = float(h) / 4294967295.0 * 6.28318530718;
+    agent.age = 0.0;
+    return agent;
+}
 
 void main() {
-    if (pushConstants.deltaTime <= 0.0) {
-        return; // Skip processing if deltaTime is zero or negative
+    if (gl_LocalInvocationIndex == 0) {
+        groupCount = 0;
     }
 
-    // Get the global pixel coordinate for this invocation
-    uint agentID = gl_GlobalInvocationID.x;
-    if (agentID >= pushConstants.agentCount) {
-        return; // Out of bounds, skip this invocation
+    barrier();
+
+    // the first count invocations update an agent, the next spawnCount spawn one
+    uint agentID = AGENT_INDEX;
+    uint count = populationBuffers[pushConstants.populationBuffer].population.count;
+    uint spawnCount = populationBuffers[pushConstants.populationBuffer].population.spawnCount;
+    vec2 size = vec2(trailSize(pushConstants.readImage));
+
+    Agent agent;
+    bool alive = agentID < count + spawnCount;
+
+    if (agentID < count) {
+        agent = agentBuffers[pushConstants.agentBuffer].agents[agentID];
+
+        // a paused step carries the agents over unchanged
+        if (pushConstants.deltaTime > 0.0) {
+            vec2 vel = vec2(cos(agent.angle), sin(agent.angle)) * SPEED * pushConstants.deltaTime;
+            agent.position = mod(agent.position + vel, size); // Wrap around the image size
+            agent.age += pushConstants.deltaTime;
+        }
+
+        alive = LIFETIME <= 0.0 || agent.age < LIFETIME;
+    } else if (alive) {
+        agent = spawnAgent(agentID, size);
+    }
+
+    uint localSlot = 0;
+    if (alive) {
+        localSlot = atomicAdd(groupCount, 1u);
     }
 
-    Agent agent = agents[agentID];
-    vec2 vel = vec2(cos(agent.angle), sin(agent.angle)) * SPEED * pushConstants.deltaTime;
-    agent.position += vel;
-    agent.position = mod(agent.position, vec2(imageSize(readImage))); // Wrap around the image size
+    barrier();
 
-    agents[agentID] = agent; // Update the agent in the buffer
-}
\ No newline at end of file
+    if (gl_LocalInvocationIndex == 0 && groupCount > 0) {
+        groupBase = atomicAdd(populationBuffers[pushConstants.populationBuffer].population.nextCount, groupCount);
+    }
+
+    barrier();
+
+    if (alive) {
+        agentBuffers[pushConstants.nextAgentBuffer].agents[groupBase + localSlot] = agent;
+    }
+}
@@ -3,68 +3,296 @@
 #include <vulkan/vulkan.h>
 
 #include "graphics/Camera.h"
+#include "tools/consts.h"
+#include "tools/WorkerPool.h"
 
 #include <stdexcept>
 #include <iostream>
+#include <future>
+#include <string>
+#include <algorithm>
+#include <cmath>
+
+
+namespace {
+    // reads the SPIR-V, creates the module and pipeline, then destroys the module. Meant to run on a worker thread
+    std::future<vktools::PipelineInfo> buildComputePipelineAsync(
+            raymarcher::tools::WorkerPool& workerPool, VkDevice logicalDevice, std::string shaderPath,
+            raymarcher::core::SpecializationConstants specialization, VkPipelineLayout pipelineLayout,
+            raymarcher::core::PipelineCache* pipelineCache) {
+
+        return workerPool.submit([=]() {
+            raymarcher::graphics::Shader shader{logicalDevice, shaderPath, VK_SHADER_STAGE_COMPUTE_BIT, specialization};
+            VkPipeline pipeline = vktools::buildComputePipeline(logicalDevice, pipelineLayout, shader, pipelineCache);
+            shader.destroy(logicalDevice);
+
+            return vktools::PipelineInfo{pipeline, pipelineLayout};
+        });
+    }
+
+    // one side of a normalized Gaussian kernel: weight i applies to the pixels i away from the center, on both sides
+    std::vector<float> gaussianWeights(float sigma) {
+        if (sigma <= 0) {
+            return {1.0f};
+        }
+
+        // only the box blur gets here with a larger sigma, and only uses the weights for the specialization constant
+        int radius = std::min(static_cast<int>(std::ceil(3.0f * sigma)), BLUR_MAX_RADIUS);
+
+        std::vector<float> weights(radius + 1);
+        float sum = 0;
+
+        for (int i = 0; i <= radius; i++) {
+            weights[i] = std::exp(-static_cast<float>(i * i) / (2.0f * sigma * sigma));
+            sum += i == 0 ? weights[i] : 2 * weights[i];
+        }
+
+        for (float& weight : weights) {
+            weight /= sum;
+        }
+
+        return weights;
+    }
+
+    int32_t trailFormatId(VkFormat format) {
+        switch (format) {
+            case VK_FORMAT_R16_SFLOAT:
+                return TRAIL_FORMAT_R16F;
+            case VK_FORMAT_R32_SFLOAT:
+                return TRAIL_FORMAT_R32F;
+            case VK_FORMAT_R32_UINT:
+                return TRAIL_FORMAT_R32UI;
+            default:
+                throw std::runtime_error("Trail map format must be R16_SFLOAT, R32_SFLOAT or R32_UINT");
+        }
+    }
+
+    int32_t depositModeId(DepositMode mode) {
+        switch (mode) {
+            case DepositMode::STORE:
+                return DEPOSIT_MODE_STORE;
+            case DepositMode::ATOMIC:
+                return DEPOSIT_MODE_ATOMIC;
+            case DepositMode::HISTOGRAM:
+                return DEPOSIT_MODE_HISTOGRAM;
+        }
+
+        throw std::runtime_error("Unknown deposit mode");
+    }
+
+    // radii of passes box filters whose repeated application approximates a Gaussian with sigma, after Kovesi,
+    //  "Fast Almost-Gaussian Filtering". box widths are odd, the narrower ones come first. radius 0 boxes are dropped
+    std::vector<int> boxRadii(float sigma, uint32_t passes) {
+        if (sigma <= 0 || passes == 0) {
+            return {};
+        }
+
+        const auto n = static_cast<float>(passes);
+        const float idealWidth = std::sqrt(12.0f * sigma * sigma / n + 1.0f);
+
+        int lowerWidth = static_cast<int>(std::floor(idealWidth));
+        if (lowerWidth % 2 == 0) {
+            lowerWidth--;
+        }
+
+        // how many of the passes use the lower width, so the variances add up to sigma^2
+        const auto lower = static_cast<float>(lowerWidth);
+        const float idealLowerCount = (12.0f * sigma * sigma - n * lower * lower - 4.0f * n * lower - 3.0f * n) / (-4.0f * lower - 4.0f);
+        const int lowerCount = std::clamp(static_cast<int>(std::round(idealLowerCount)), 0, static_cast<int>(passes));
+
+        std::vector<int> radii;
+        for (int i = 0; i < static_cast<int>(passes); i++) {
+            int width = i < lowerCount ? lowerWidth : lowerWidth + 2;
+            if (width > 1) {
+                radii.push_back((width - 1) / 2);
+            }
+        }
+
+        return radii;
+    }
+
+    // the host side of agentDispatch() in population.comp.glsl: rows of at most maxGroupsX workgroups
+    VkDispatchIndirectCommand agentDispatch(uint32_t agents, uint32_t workgroupSize, uint32_t maxGroupsX) {
+        const uint32_t groups = (agents + workgroupSize - 1) / workgroupSize;
+        return VkDispatchIndirectCommand{std::min(groups, maxGroupsX), (groups + maxGroupsX - 1) / maxGroupsX, 1};
+    }
+}
+
+bool Raymarcher::supportsPassTiming(VkPhysicalDevice physicalDevice) {
+    VkPhysicalDeviceProperties deviceProperties;
+    vkGetPhysicalDeviceProperties(physicalDevice, &deviceProperties);
+
+    // the simulation queue family does not depend on the surface, only the present family does
+    vktools::QueueFamilyIndices indices = vktools::findQueueFamilies(VK_NULL_HANDLE, physicalDevice);
+    uint32_t computeQueueFamily = indices.asyncComputeFamily.value_or(indices.computeFamily.value());
+
+    uint32_t familyCount = 0;
+    vkGetPhysicalDeviceQueueFamilyProperties(physicalDevice, &familyCount, nullptr);
+    std::vector<VkQueueFamilyProperties> families(familyCount);
+    vkGetPhysicalDeviceQueueFamilyProperties(physicalDevice, &familyCount, families.data());
+
+    return families[computeQueueFamily].timestampValidBits != 0 && deviceProperties.limits.timestampPeriod > 0;
+}
+
+void Raymarcher::checkDeviceLimits(const RaymarcherConfig& config, VkPhysicalDevice physicalDevice) {
+    VkPhysicalDeviceProperties deviceProperties;
+    vkGetPhysicalDeviceProperties(physicalDevice, &deviceProperties);
+    const VkPhysicalDeviceLimits& limits = deviceProperties.limits;
+
+    const uint32_t width = config.simulationWidth;
+    const uint32_t height = config.simulationHeight;
+
+    if (config.agentWorkgroupSize > limits.maxComputeWorkGroupSize[0] || config.agentWorkgroupSize > limits.maxComputeWorkGroupInvocations
+        || config.imageWorkgroupWidth > limits.maxComputeWorkGroupSize[0] || config.imageWorkgroupHeight > limits.maxComputeWorkGroupSize[1]
+        || config.imageWorkgroupWidth * config.imageWorkgroupHeight > limits.maxComputeWorkGroupInvocations) {
+        throw std::runtime_error("Configured workgroup size exceeds the device's compute limits");
+    }
+
+    // the image passes dispatch one invocation per pixel, the box blur one workgroup per row or column
+    const uint32_t imageGroupsX = (width + config.imageWorkgroupWidth - 1) / config.imageWorkgroupWidth;
+    const uint32_t imageGroupsY = (height + config.imageWorkgroupHeight - 1) / config.imageWorkgroupHeight;
+    const uint32_t boxBlurGroups = std::max(width, height);
+
+    if (imageGroupsX > limits.maxComputeWorkGroupCount[0] || imageGroupsY > limits.maxComputeWorkGroupCount[1]
+        || boxBlurGroups > limits.maxComputeWorkGroupCount[0]) {
+        throw std::runtime_error("Simulation resolution needs more workgroups than the device can dispatch, raise the image workgroup size");
+    }
+
+    // agent passes spread their workgroups over rows, see update.h. a full agent buffer has to fit in the rows the
+    //  device can dispatch, and in one storage buffer binding
+    const uint64_t agentGroupsX = limits.maxComputeWorkGroupCount[0];
+    const uint64_t agentGroups = (static_cast<uint64_t>(config.agentCapacity) + config.agentWorkgroupSize - 1) / config.agentWorkgroupSize;
+    const uint64_t agentBufferBytes = static_cast<uint64_t>(config.agentCapacity) * sizeof(Agent);
+
+    if ((agentGroups + agentGroupsX - 1) / agentGroupsX > limits.maxComputeWorkGroupCount[1]) {
+        throw std::runtime_error("Agent capacity of " + std::to_string(config.agentCapacity) + " needs more workgroups than the device can dispatch");
+    }
+
+    if (agentBufferBytes > limits.maxStorageBufferRange) {
+        throw std::runtime_error("Agent capacity of " + std::to_string(config.agentCapacity) + " needs " + std::to_string(agentBufferBytes)
+                                 + " byte agent buffers, more than the device's storage buffer range of " + std::to_string(limits.maxStorageBufferRange));
+    }
+
+    // the agents and their next version. CPU implementations may report no device-local memory, see pickPhysicalDevice()
+    const uint64_t deviceLocalMemory = vktools::getDeviceLocalMemory(physicalDevice);
+    if (deviceLocalMemory != 0 && 2 * agentBufferBytes > deviceLocalMemory) {
+        throw std::runtime_error("Agent capacity of " + std::to_string(config.agentCapacity) + " needs more memory than the device has");
+    }
+
+    // the Gaussian blur keeps its tile and the horizontally blurred rows in shared memory, see blur.comp.glsl
+    const auto blurRadius = static_cast<uint32_t>(gaussianWeights(config.blurSigma).size() - 1);
+    const uint32_t tileHeight = config.imageWorkgroupHeight + 2 * blurRadius;
+    const uint32_t blurSharedBytes = (config.imageWorkgroupWidth + 2 * blurRadius + config.imageWorkgroupWidth) * tileHeight * sizeof(float);
+
+    if (config.blurMode == BlurMode::GAUSSIAN && blurSharedBytes > limits.maxComputeSharedMemorySize) {
+        throw std::runtime_error("Blur tile of " + std::to_string(blurSharedBytes) + " bytes exceeds the device's shared memory, lower the workgroup size or blur sigma");
+    }
 
+    // the box blur keeps the prefix sums of a whole line in shared memory, see boxblur.comp.glsl
+    const uint32_t boxBlurLine = std::max(width, height);
+    const uint32_t boxBlurSharedBytes = (boxBlurLine + 1 + BOX_BLUR_WORKGROUP_SIZE) * sizeof(float);
 
-Raymarcher::Raymarcher() {
+    if (config.blurMode == BlurMode::BOX && boxBlurSharedBytes > limits.maxComputeSharedMemorySize) {
+        throw std::runtime_error("Box blur lines of " + std::to_string(boxBlurLine) + " pixels exceed the device's shared memory, lower the resolution");
+    }
+
+    VkFormatProperties trailFormatProperties;
+    vkGetPhysicalDeviceFormatProperties(physicalDevice, config.trailFormat, &trailFormatProperties);
+    if ((trailFormatProperties.optimalTilingFeatures & VK_FORMAT_FEATURE_STORAGE_IMAGE_BIT) == 0) {
+        throw std::runtime_error("Device does not support the trail map format as a storage image");
+    }
+
+    if (config.timePasses && !supportsPassTiming(physicalDevice)) {
+        throw std::runtime_error("Simulation queue does not support timestamps, which timing passes requires");
+    }
+}
+
+Raymarcher::Raymarcher(const RaymarcherConfig& config) : config(config) {
     // init
-    renderWidth = 800;  // todo: bug - when renderWidth < windowWidth, the image appears stretched
-    renderHeight = 800;
-    const float aspectRatio = static_cast<float>(renderWidth) / static_cast<float>(renderHeight);
+    renderWidth = config.simulationWidth;
+    renderHeight = config.simulationHeight;
+
+    if (renderWidth == 0 || renderHeight == 0) {
+        throw std::runtime_error("Simulation resolution must not be zero");
+    }
 
-    windowWidth = 800;
-    windowHeight = static_cast<int>(static_cast<float>(windowWidth) / aspectRatio);
+    // the Gaussian kernel covers 3 sigma on each side, and the fused pass only holds BLUR_MAX_RADIUS of apron
+    if (config.blurMode == BlurMode::GAUSSIAN && std::ceil(3.0f * config.blurSigma) > BLUR_MAX_RADIUS) {
+        throw std::runtime_error("Blur sigma " + std::to_string(config.blurSigma) + " needs a radius above the Gaussian blur's maximum of "
+                                 + std::to_string(BLUR_MAX_RADIUS) + ", use the box blur for it");
+    }
 
-    renderWindow = raymarcher::window::Window {windowWidth, windowHeight};
+    // boxes one pixel wide are skipped, which can leave nothing to blur with
+    if (config.blurMode == BlurMode::BOX && boxRadii(config.blurSigma, config.boxBlurPasses).empty()) {
+        throw std::runtime_error("Blur sigma " + std::to_string(config.blurSigma) + " is too small for the box blur, every box would be one pixel wide");
+    }
+
+    const float aspectRatio = static_cast<float>(renderWidth) / static_cast<float>(renderHeight);
 
-    instance = vktools::createInstance();
+    if (!config.headless) {
+        renderWindow = raymarcher::window::Window {config.windowWidth, config.windowHeight};
+    }
+
+    instance = vktools::createInstance(config.headless);
     debugMessenger = vktools::createDebugMessenger(instance);
-    surface = vktools::createSurface(instance, renderWindow.getGlfwWindow());
-    VkPhysicalDevice physicalDevice = vktools::pickPhysicalDevice(instance);
-    logicalDevice = vktools::createLogicalDevice(surface, physicalDevice);
 
+    if (!config.headless) {
+        surface = vktools::createSurface(instance, renderWindow.getGlfwWindow());
+    }
+
+    physicalDevice = vktools::pickPhysicalDevice(instance, surface);
+    checkDeviceLimits(config, physicalDevice);
+    capabilities = vktools::queryDeviceCapabilities(surface, physicalDevice);
+    logicalDevice = vktools::createLogicalDevice(surface, physicalDevice, capabilities);
+
+    VkPhysicalDeviceProperties deviceProperties;
+    vkGetPhysicalDeviceProperties(physicalDevice, &deviceProperties);
+    std::cout << "Using device: " << deviceProperties.deviceName
+              << " (ray tracing: " << (capabilities.rayTracing ? "yes" : "no")
+              << ", anisotropy: " << (capabilities.samplerAnisotropy ? "yes" : "no")
+              << ", push descriptors: " << (capabilities.pushDescriptor ? "yes" : "no") << ")\n";
+
+    // the simulation runs on an async compute family when there is one, so it can overlap with the display pass.
+    //  otherwise everything goes through the graphics (or, headless, any compute) family
     vktools::QueueFamilyIndices indices = vktools::findQueueFamilies(surface, physicalDevice);
-    vkGetDeviceQueue(logicalDevice, indices.graphicsFamily.value(), 0, &graphicsQueue);
-    vkGetDeviceQueue(logicalDevice, indices.presentFamily.value(), 0, &presentQueue);
+    uint32_t computeQueueFamily = indices.asyncComputeFamily.value_or(indices.computeFamily.value());
+    vkGetDeviceQueue(logicalDevice, computeQueueFamily, 0, &computeQueue);
 
-    swapchainObjects = vktools::createSwapchain(surface, physicalDevice, logicalDevice, renderWindow.getWidth(), renderWindow.getHeight());
-    swapchainImageViews = vktools::createSwapchainImageViews(logicalDevice, swapchainObjects.swapchainImageFormat, swapchainObjects.swapchainImages);
+    // queue families the display images are used on
+    std::vector<uint32_t> displayQueueFamilies = {computeQueueFamily};
 
-    commandPool = vktools::createCommandPool(physicalDevice, logicalDevice, surface);
+    if (!config.headless) {
+        vkGetDeviceQueue(logicalDevice, indices.graphicsFamily.value(), 0, &graphicsQueue);
 
-    cmdBuffer = raymarcher::core::CmdBuffer{logicalDevice, commandPool, false, true};
-    cmdBuffer.endWaitSubmit(logicalDevice, graphicsQueue);  // since the command buffer automatically begins upon creation, and we don't want that in this specific case
+        if (indices.graphicsFamily.value() != computeQueueFamily) {
+            displayQueueFamilies.push_back(indices.graphicsFamily.value());
+        }
+    }
+
+    std::cout << "Simulation queue family: " << computeQueueFamily << (computeQueueFamily != indices.computeFamily.value() ? " (async compute)\n" : "\n");
+
+    pipelineCache = raymarcher::core::PipelineCache{logicalDevice, physicalDevice, consts::PIPELINE_CACHE_PATH};
+    memoryAllocator = raymarcher::core::MemoryAllocator{physicalDevice};
+    stagingRing = raymarcher::core::StagingRing{logicalDevice, memoryAllocator};
 
     glm::vec3 pos = glm::vec3(-1.6899, 0.317017, 1.6386);
     glm::vec3 lookAt = glm::vec3(0, 0.962f, 0);
-    camera = raymarcher::graphics::Camera{renderWindow, glm::radians(25.0f), aspectRatio, pos, glm::normalize(lookAt - pos)};
-
-    pingImage = raymarcher::graphics::Image{
-            logicalDevice, physicalDevice, renderWidth, renderHeight, VK_FORMAT_R8G8B8A8_UNORM,
-            VK_IMAGE_USAGE_STORAGE_BIT | VK_IMAGE_USAGE_SAMPLED_BIT | VK_IMAGE_USAGE_TRANSFER_SRC_BIT,
-            VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT
-    };
+    if (!config.headless) {
+        camera = raymarcher::graphics::Camera{renderWindow, glm::radians(25.0f), aspectRatio, pos, glm::normalize(lookAt - pos)};
+    }
 
-    pongImage = raymarcher::graphics::Image{
-            logicalDevice, physicalDevice, renderWidth, renderHeight, VK_FORMAT_R8G8B8A8_UNORM,
-            VK_IMAGE_USAGE_STORAGE_BIT | VK_IMAGE_USAGE_SAMPLED_BIT | VK_IMAGE_USAGE_TRANSFER_SRC_BIT,
-            VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT
+    blurPushConsts = raymarcher::core::PushConstants{
+            BlurPushConsts{},
+            VK_SHADER_STAGE_COMPUTE_BIT
     };
 
-    writeImage = &pingImage;
-    readImage = &pongImage;
-
-    fragmentImageSampler = vktools::createSampler(logicalDevice);
-
-    blurXPushConsts = raymarcher::core::PushConstants{
-        ComputePushConsts{camera.getInverseView(), camera.getInverseProjection()},
-        VK_SHADER_STAGE_COMPUTE_BIT
+    boxBlurPushConsts = raymarcher::core::PushConstants{
+            BoxBlurPushConsts{},
+            VK_SHADER_STAGE_COMPUTE_BIT
     };
 
-    blurYPushConsts = raymarcher::core::PushConstants{
-            ComputePushConsts{camera.getInverseView(), camera.getInverseProjection()},
+    displayPushConsts = raymarcher::core::PushConstants{
+            DisplayPushConsts{},
             VK_SHADER_STAGE_COMPUTE_BIT
     };
 
@@ -78,243 +306,742 @@ Raymarcher::Raymarcher() {
             VK_SHADER_STAGE_COMPUTE_BIT
     };
 
-    updateDescriptorSet = raymarcher::core::DescriptorSet{
-            logicalDevice,
-            {
-                    raymarcher::core::Binding{0, VK_DESCRIPTOR_TYPE_STORAGE_IMAGE, 1, VK_SHADER_STAGE_COMPUTE_BIT},
-                    raymarcher::core::Binding{1, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, 1, VK_SHADER_STAGE_COMPUTE_BIT}  // agent positions
-            }
+    resolveDepositsPushConsts = raymarcher::core::PushConstants{
+            DepositPushConsts{},
+            VK_SHADER_STAGE_COMPUTE_BIT
     };
 
-    drawAgentsDescriptorSet = raymarcher::core::DescriptorSet{
-            logicalDevice,
-            {
-                    raymarcher::core::Binding{0, VK_DESCRIPTOR_TYPE_STORAGE_IMAGE, 1, VK_SHADER_STAGE_COMPUTE_BIT},
-                    raymarcher::core::Binding{1, VK_DESCRIPTOR_TYPE_STORAGE_IMAGE, 1, VK_SHADER_STAGE_COMPUTE_BIT},
-                    raymarcher::core::Binding{2, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, 1, VK_SHADER_STAGE_COMPUTE_BIT}  // agent positions
-            }
+    sortPushConsts = raymarcher::core::PushConstants{
+            SortPushConsts{},
+            VK_SHADER_STAGE_COMPUTE_BIT
     };
 
-    blurXDescriptorSet = raymarcher::core::DescriptorSet{
-            logicalDevice,
-            {
-                    raymarcher::core::Binding{0, VK_DESCRIPTOR_TYPE_STORAGE_IMAGE, 1, VK_SHADER_STAGE_COMPUTE_BIT},
-                    raymarcher::core::Binding{1, VK_DESCRIPTOR_TYPE_STORAGE_IMAGE, 1, VK_SHADER_STAGE_COMPUTE_BIT}
-            }
-    };
-    raymarcher::graphics::Shader blurXShader{logicalDevice, "shaders/blur/blurx.comp.spv", VK_SHADER_STAGE_COMPUTE_BIT};
-    blurXPipeline = vktools::createComputePipeline(logicalDevice, blurXDescriptorSet, blurXShader, blurXPushConsts);
-    blurXShader.destroy(logicalDevice);
-
-    blurYDescriptorSet = raymarcher::core::DescriptorSet{
-            logicalDevice,
-            {
-                    raymarcher::core::Binding{0, VK_DESCRIPTOR_TYPE_STORAGE_IMAGE, 1, VK_SHADER_STAGE_COMPUTE_BIT},
-                    raymarcher::core::Binding{1, VK_DESCRIPTOR_TYPE_STORAGE_IMAGE, 1, VK_SHADER_STAGE_COMPUTE_BIT}
-            }
-    };
-    raymarcher::graphics::Shader blurYShader{logicalDevice, "shaders/blur/blury.comp.spv", VK_SHADER_STAGE_COMPUTE_BIT};
-    blurYPipeline = vktools::createComputePipeline(logicalDevice, blurYDescriptorSet, blurYShader, blurYPushConsts);
-    blurYShader.destroy(logicalDevice);
-
-    raymarcher::graphics::Shader updateShader{logicalDevice, "shaders/update/update.comp.spv", VK_SHADER_STAGE_COMPUTE_BIT};
-    updatePipeline = vktools::createComputePipeline(logicalDevice, updateDescriptorSet, updateShader, updatePushConsts);
-    updateShader.destroy(logicalDevice);
-
-    rasterDescriptorSet = raymarcher::core::DescriptorSet{
-            logicalDevice,
-            {
-                    raymarcher::core::Binding{0, VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, 1, VK_SHADER_STAGE_FRAGMENT_BIT}
-            }
+    populationPushConsts = raymarcher::core::PushConstants{
+            PopulationPushConsts{},
+            VK_SHADER_STAGE_COMPUTE_BIT
     };
 
-    raymarcher::graphics::Shader drawAgentsShader{logicalDevice, "shaders/update/drawagents.comp.spv", VK_SHADER_STAGE_COMPUTE_BIT};
-    drawAgentsPipeline = vktools::createComputePipeline(logicalDevice, drawAgentsDescriptorSet, drawAgentsShader, drawAgentsPushConsts);
-    updateShader.destroy(logicalDevice);
+    if (config.framesInFlight == 0) {
+        throw std::runtime_error("At least one frame in flight is required");
+    }
 
-    raymarcher::graphics::Shader vertexShader = raymarcher::graphics::Shader(logicalDevice, "shaders/raster/display.vert.spv", VK_SHADER_STAGE_VERTEX_BIT);
-    raymarcher::graphics::Shader fragmentShader = raymarcher::graphics::Shader(logicalDevice, "shaders/raster/display.frag.spv", VK_SHADER_STAGE_FRAGMENT_BIT);
+    frames.resize(config.framesInFlight);
 
-    renderPass = vktools::createRenderPass(logicalDevice, swapchainObjects.swapchainImageFormat);
-    rasterPipeline = vktools::createRasterizationPipeline(logicalDevice, rasterDescriptorSet, renderPass, vertexShader, fragmentShader);
+    // every compute pass addresses its resources through the bindless table, so they all share one pipeline layout
+    //  whose push constant range fits the largest pass. binding the table once then stays valid for every pass
+    bindlessTable = raymarcher::core::BindlessTable{logicalDevice, descriptorAllocator};
 
-    framebuffers = vktools::createSwapchainFramebuffers(logicalDevice, renderPass, swapchainObjects.swapchainExtent, swapchainImageViews);
+    computePipelineLayout = vktools::createPipelineLayout(logicalDevice, bindlessTable.getLayout(), VkPushConstantRange{
+            .stageFlags = VK_SHADER_STAGE_COMPUTE_BIT,
+            .offset = 0,
+            .size = static_cast<uint32_t>(std::max({sizeof(BlurPushConsts), sizeof(BoxBlurPushConsts), sizeof(UpdatePushConsts), sizeof(DisplayPushConsts), sizeof(DepositPushConsts), sizeof(SortPushConsts), sizeof(PopulationPushConsts)}))
+    });
+
+    // the display image changes with every frame slot. pushing it needs no sets at all, otherwise there is one per slot
+    if (!config.headless) {
+        std::vector<raymarcher::core::Binding> rasterBindings{
+                raymarcher::core::Binding{0, VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, 1, VK_SHADER_STAGE_FRAGMENT_BIT}
+        };
+
+        if (capabilities.pushDescriptor) {
+            rasterDescriptorSet = raymarcher::core::DescriptorSet::createPushDescriptorSet(logicalDevice, descriptorAllocator, rasterBindings);
+        } else {
+            rasterDescriptorSet = raymarcher::core::DescriptorSet{logicalDevice, descriptorAllocator, rasterBindings, config.framesInFlight};
+        }
+    }
+
+    // Pipeline creation is dominated by driver shader compilation, so build all pipelines on a worker pool while the
+    //  swapchain, images and buffers are created below. Only layouts are needed to start, and everything is joined
+    //  at the end of the constructor, before the first frame.
+    // agent passes spread their workgroups over rows, see update.h
+    agentGroupsX = deviceProperties.limits.maxComputeWorkGroupCount[0];
+
+    // the Gaussian blur's kernel, and the longest line the box blur keeps in shared memory
+    std::vector<float> blurWeightValues = gaussianWeights(config.blurSigma);
+    const auto blurRadius = static_cast<uint32_t>(blurWeightValues.size() - 1);
+    const uint32_t boxBlurLine = std::max(renderWidth, renderHeight);
+
+    // every pass touching the trail map needs its format, see trail.h
+    const int32_t trailFormat = trailFormatId(config.trailFormat);
+
+    raymarcher::core::SpecializationConstants agentSpecialization;
+    agentSpecialization.set(SPEC_ID_LOCAL_SIZE_X, config.agentWorkgroupSize)
+                       .set(SPEC_ID_AGENT_SPEED, config.agentSpeed)
+                       .set(SPEC_ID_TRAIL_FORMAT, trailFormat)
+                       .set(SPEC_ID_DEPOSIT_MODE, depositModeId(config.depositMode))
+                       .set(SPEC_ID_AGENT_LIFETIME, config.agentLifetime);
+
+    raymarcher::core::SpecializationConstants imageSpecialization;
+    imageSpecialization.set(SPEC_ID_LOCAL_SIZE_X, config.imageWorkgroupWidth)
+                       .set(SPEC_ID_LOCAL_SIZE_Y, config.imageWorkgroupHeight)
+                       .set(SPEC_ID_TRAIL_FORMAT, trailFormat);
+
+    raymarcher::core::SpecializationConstants blurSpecialization = imageSpecialization;
+    blurSpecialization.set(SPEC_ID_BLUR_RADIUS, blurRadius);
+
+    raymarcher::core::SpecializationConstants boxBlurSpecialization;
+    boxBlurSpecialization.set(SPEC_ID_TRAIL_FORMAT, trailFormat)
+                         .set(SPEC_ID_BOX_BLUR_LINE, static_cast<int32_t>(boxBlurLine));
+
+    raymarcher::tools::WorkerPool workerPool{std::thread::hardware_concurrency()};
+
+    std::future<vktools::PipelineInfo> blurFuture = config.blurMode == BlurMode::GAUSSIAN
+            ? buildComputePipelineAsync(workerPool, logicalDevice, "shaders/blur/blur.comp.spv", blurSpecialization, computePipelineLayout, &pipelineCache)
+            : buildComputePipelineAsync(workerPool, logicalDevice, "shaders/blur/boxblur.comp.spv", boxBlurSpecialization, computePipelineLayout, &pipelineCache);
+    std::future<vktools::PipelineInfo> updateFuture = buildComputePipelineAsync(workerPool, logicalDevice, "shaders/update/update.comp.spv", agentSpecialization, computePipelineLayout, &pipelineCache);
+    std::future<vktools::PipelineInfo> drawAgentsFuture = buildComputePipelineAsync(workerPool, logicalDevice, "shaders/update/drawagents.comp.spv", agentSpecialization, computePipelineLayout, &pipelineCache);
+    std::future<vktools::PipelineInfo> populationFuture = buildComputePipelineAsync(workerPool, logicalDevice, "shaders/update/population.comp.spv", agentSpecialization, computePipelineLayout, &pipelineCache);
+    std::future<vktools::PipelineInfo> resolveDepositsFuture;
+    std::future<vktools::PipelineInfo> sortFuture;
+    std::future<vktools::PipelineInfo> sortScanFuture;
+    std::future<vktools::PipelineInfo> rasterFuture;
+    std::future<vktools::PipelineInfo> colorizeFuture;
+
+    // counted deposits are added to the trail map by a resolve pass. the histogram's two uints per agent invocation
+    //  stay well below the 16 KiB of shared memory every device has
+    if (config.depositMode != DepositMode::STORE) {
+        resolveDepositsFuture = buildComputePipelineAsync(workerPool, logicalDevice, "shaders/update/resolvedeposits.comp.spv", imageSpecialization, computePipelineLayout, &pipelineCache);
+    }
+
+    if (config.agentSortInterval != 0) {
+        sortFuture = buildComputePipelineAsync(workerPool, logicalDevice, "shaders/sort/morton.comp.spv", agentSpecialization, computePipelineLayout, &pipelineCache);
+        sortScanFuture = buildComputePipelineAsync(workerPool, logicalDevice, "shaders/sort/scan.comp.spv", {}, computePipelineLayout, &pipelineCache);
+    }
+
+    // everything in this block is only needed to display the simulation
+    if (!config.headless) {
+        vkGetDeviceQueue(logicalDevice, indices.presentFamily.value(), 0, &presentQueue);
+
+        swapchainObjects = vktools::createSwapchain(surface, physicalDevice, logicalDevice, renderWindow.getWidth(), renderWindow.getHeight());
+        renderPass = vktools::createRenderPass(logicalDevice, swapchainObjects.swapchainImageFormat);
+        colorizeFuture = buildComputePipelineAsync(workerPool, logicalDevice, "shaders/display/colorize.comp.spv", imageSpecialization, computePipelineLayout, &pipelineCache);
+
+        rasterFuture = workerPool.submit([this]() {
+            raymarcher::graphics::Shader vertexShader = raymarcher::graphics::Shader(logicalDevice, "shaders/raster/display.vert.spv", VK_SHADER_STAGE_VERTEX_BIT);
+            raymarcher::graphics::Shader fragmentShader = raymarcher::graphics::Shader(logicalDevice, "shaders/raster/display.frag.spv", VK_SHADER_STAGE_FRAGMENT_BIT);
+
+            vktools::PipelineInfo pipeline = vktools::createRasterizationPipeline(logicalDevice, rasterDescriptorSet, renderPass, vertexShader, fragmentShader, &pipelineCache);
+
+            vertexShader.destroy(logicalDevice);
+            fragmentShader.destroy(logicalDevice);
+
+            return pipeline;
+        });
+
+        swapchainImageViews = vktools::createSwapchainImageViews(logicalDevice, swapchainObjects.swapchainImageFormat, swapchainObjects.swapchainImages);
+        framebuffers = vktools::createSwapchainFramebuffers(logicalDevice, renderPass, swapchainObjects.swapchainExtent, swapchainImageViews);
+
+        fragmentImageSampler = vktools::createSampler(logicalDevice, capabilities.samplerAnisotropy);
+
+        graphicsCommandPool = vktools::createCommandPool(logicalDevice, indices.graphicsFamily.value());
+
+        VkSemaphoreCreateInfo semaphoreInfo{VK_STRUCTURE_TYPE_SEMAPHORE_CREATE_INFO};
+
+        for (FrameResources& frame : frames) {
+            frame.syncObjects = vktools::createSyncObjects(logicalDevice);
+
+            if (vkCreateSemaphore(logicalDevice, &semaphoreInfo, nullptr, &frame.computeFinishedSemaphore) != VK_SUCCESS) {
+                throw std::runtime_error("Failed to create compute semaphore");
+            }
+
+            frame.graphicsCmdBuffer = raymarcher::core::CmdBuffer{logicalDevice, graphicsCommandPool, false, true};
+            frame.graphicsCmdBuffer.endWaitSubmit(logicalDevice, graphicsQueue);  // since the command buffer automatically begins upon creation, and we don't want that in this specific case
+
+            frame.displayImage = raymarcher::graphics::Image{
+                    logicalDevice, memoryAllocator, renderWidth, renderHeight, VK_FORMAT_R8G8B8A8_UNORM,
+                    VK_IMAGE_USAGE_SAMPLED_BIT | VK_IMAGE_USAGE_STORAGE_BIT,
+                    VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT,
+                    displayQueueFamilies
+            };
+        }
+    }
 
-    vertexShader.destroy(logicalDevice);
-    fragmentShader.destroy(logicalDevice);
+    computeCommandPool = vktools::createCommandPool(logicalDevice, computeQueueFamily);
 
-    syncObjects = vktools::createSyncObjects(logicalDevice);
+    for (FrameResources& frame : frames) {
+        frame.computeCmdBuffer = raymarcher::core::CmdBuffer{logicalDevice, computeCommandPool, false, true};
+        frame.computeCmdBuffer.endWaitSubmit(logicalDevice, computeQueue);  // since the command buffer automatically begins upon creation, and we don't want that in this specific case
+    }
 
-    VkDeviceSize imageSize = renderWidth * renderHeight * 4;  // RGBA8
+    // single channel, the colorize pass maps trail values to the display image's color
+    pingImage = raymarcher::graphics::Image{
+            logicalDevice, memoryAllocator, renderWidth, renderHeight, config.trailFormat,
+            VK_IMAGE_USAGE_STORAGE_BIT,
+            VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT
+    };
 
-    stagingBuffer = raymarcher::core::Buffer{
-            logicalDevice, physicalDevice, imageSize,
-            VK_BUFFER_USAGE_TRANSFER_DST_BIT,
-            static_cast<VkMemoryAllocateFlags>(0),
-            VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT
+    pongImage = raymarcher::graphics::Image{
+            logicalDevice, memoryAllocator, renderWidth, renderHeight, config.trailFormat,
+            VK_IMAGE_USAGE_STORAGE_BIT,
+            VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT
     };
 
+    // cleared by the first frame, then by every resolve pass. R32_UINT storage atomics are required by Vulkan
+    if (config.depositMode != DepositMode::STORE) {
+        depositImage = raymarcher::graphics::Image{
+                logicalDevice, memoryAllocator, renderWidth, renderHeight, VK_FORMAT_R32_UINT,
+                VK_IMAGE_USAGE_STORAGE_BIT | VK_IMAGE_USAGE_TRANSFER_DST_BIT,
+                VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT
+        };
+    }
+
     std::vector<Agent> defaultAgents;
     defaultAgents.push_back(Agent{glm::vec2(400, 400), 0});
 
-    agentsBuffer = raymarcher::core::Buffer{
-        logicalDevice, physicalDevice, defaultAgents,
+    if (defaultAgents.size() > config.agentCapacity) {
+        throw std::runtime_error("Agent capacity is smaller than the initial agent count");
+    }
+
+    // agents live in device local memory. the initial set goes through the staging ring and is copied in by the first
+    //  frame, and the host only sees them through agentReadback. both buffers have room for every agent update can
+    //  append, the population says how many of them are alive
+    agentsBuffer = raymarcher::core::TypedBuffer<Agent>{
+        logicalDevice, memoryAllocator, config.agentCapacity,
+        VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_SRC_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT,
+        static_cast<VkMemoryAllocateFlags>(0)
+    };
+
+    stagingRing.uploadToBuffer(agentsBuffer.getBuffer(), defaultAgents.data(), defaultAgents.size() * sizeof(Agent));
+
+    nextAgents = raymarcher::core::TypedBuffer<Agent>{
+        logicalDevice, memoryAllocator, config.agentCapacity,
+        VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
+        static_cast<VkMemoryAllocateFlags>(0)
+    };
+
+    // the dispatch arguments start out covering the initial agents, the sort dispatches through them before the
+    //  first population pass
+    const auto initialCount = static_cast<uint32_t>(defaultAgents.size());
+    const VkDispatchIndirectCommand initialDispatch = agentDispatch(initialCount, config.agentWorkgroupSize, agentGroupsX);
+    populationBuffer = raymarcher::core::TypedBuffer<AgentPopulation>{
+        logicalDevice, memoryAllocator, stagingRing,
+        {AgentPopulation{
+                .dispatchX = initialDispatch.x,
+                .dispatchY = initialDispatch.y,
+                .dispatchZ = initialDispatch.z,
+                .count = initialCount
+        }},
+        VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_INDIRECT_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
+        static_cast<VkMemoryAllocateFlags>(0)
+    };
+
+    if (config.agentSortInterval != 0) {
+        sortCells = raymarcher::core::TypedBuffer<uint32_t>{
+            logicalDevice, memoryAllocator, SORT_CELLS,
+            VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT,
+            static_cast<VkMemoryAllocateFlags>(0)
+        };
+    }
+
+    // as large as an agent buffer, so only made when snapshots can be taken
+    if (!config.headless || config.headlessSnapshot) {
+        agentReadback = raymarcher::core::AsyncReadback{logicalDevice, memoryAllocator, agentsBuffer.getSize()};
+    }
+
+    populationReadback = raymarcher::core::AsyncReadback{logicalDevice, memoryAllocator, populationBuffer.getSize()};
+
+    blurWeights = raymarcher::core::TypedBuffer<float>{
+        logicalDevice, memoryAllocator, stagingRing, blurWeightValues,
         VK_BUFFER_USAGE_STORAGE_BUFFER_BIT,
-        static_cast<VkMemoryAllocateFlags>(0),
-        VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT  // TODO: make this non-host visible for max perf
+        static_cast<VkMemoryAllocateFlags>(0)
     };
 
+    // join the pipeline builds. get() rethrows anything a worker threw
+    blurPipeline = blurFuture.get();
+    updatePipeline = updateFuture.get();
+    drawAgentsPipeline = drawAgentsFuture.get();
+    populationPipeline = populationFuture.get();
+
+    if (resolveDepositsFuture.valid()) {
+        resolveDepositsPipeline = resolveDepositsFuture.get();
+    }
+
+    if (sortFuture.valid()) {
+        sortPipeline = sortFuture.get();
+        sortScanPipeline = sortScanFuture.get();
+    }
+
+    if (rasterFuture.valid()) {
+        rasterPipeline = rasterFuture.get();
+        colorizePipeline = colorizeFuture.get();
+    }
+
+    std::cout << pipelineCache.summary() << memoryAllocator.summary() << descriptorAllocator.summary();
+
     writeDescriptorSets();
+    buildRenderGraph();
+
+    if (config.timePasses) {
+        passTimer = raymarcher::core::PassTimer{logicalDevice, config.framesInFlight, renderGraph.passCount(), deviceProperties.limits.timestampPeriod};
+    }
 }
 
 
 void Raymarcher::renderLoop() {
-    VkCommandBuffer cmdBufferHandle = cmdBuffer.getHandle();
+    if (config.headless) {
+        runHeadless();
+        return;
+    }
 
     raymarcher::tools::Clock clock;
     while (!renderWindow.shouldClose()) {
+        FrameResources& frame = frames[frameIndex];
+
         updatePushConsts.getPushConstants().deltaTime = static_cast<float>(clock.getTimeDelta());
-        blurXPushConsts.getPushConstants().deltaTime = static_cast<float>(clock.getTimeDelta());
-        blurYPushConsts.getPushConstants().deltaTime = static_cast<float>(clock.getTimeDelta());
 
-        // render image
-        cmdBuffer.wait(logicalDevice);
-        cmdBuffer.begin();
+        // only blocks if the GPU is still working on the frame that last used this slot. both are needed before
+        //  touching the slot's display image
+        frame.computeCmdBuffer.wait(logicalDevice);
+        frame.graphicsCmdBuffer.wait(logicalDevice);
+        stagingRing.release(frameIndex);
+        agentReadback.complete(frameIndex);
+        populationReadback.complete(frameIndex);
+        passTimer.complete(logicalDevice, frameIndex);
+
+        if (renderWindow.keyPressed(GLFW_KEY_R)) {
+            requestAgentSnapshot();
+        }
 
-        runCompute();
+        printAgentSnapshot();
 
-        // render
-        uint32_t imageIndex = -1;
-        if (!renderWindow.isMinimized()) {
-            draw(imageIndex);
-        }
+        // acquire first, so that nothing signals computeFinished for a frame that ends up not being displayed
+        uint32_t imageIndex = 0;
+        const bool display = !renderWindow.isMinimized() && acquire(frame, imageIndex);
 
-        VkPipelineStageFlags waitStages[] = {
-                VK_PIPELINE_STAGE_ALL_COMMANDS_BIT
-        };
+        // simulate. uploads queued since the last frame go first
+        frame.computeCmdBuffer.begin();
+        stagingRing.flush(frame.computeCmdBuffer.getHandle(), frameIndex);
+        recordSimulation(frame, display);
 
-        VkSubmitInfo submitInfo{
+        VkSubmitInfo computeSubmitInfo{
                 .sType                = VK_STRUCTURE_TYPE_SUBMIT_INFO,
-                .waitSemaphoreCount   = renderWindow.isMinimized() ? 0u : 1u,
-                .pWaitSemaphores      = renderWindow.isMinimized() ? nullptr : &syncObjects.imageAvailableSemaphore,
-                .pWaitDstStageMask    = waitStages,
-                .commandBufferCount   = 1,
-                .pCommandBuffers      = &cmdBufferHandle,
-                .signalSemaphoreCount = renderWindow.isMinimized() ? 0u : 1u,
-                .pSignalSemaphores    = renderWindow.isMinimized() ? nullptr : &syncObjects.renderFinishedSemaphore
+                .signalSemaphoreCount = display ? 1u : 0u,
+                .pSignalSemaphores    = display ? &frame.computeFinishedSemaphore : nullptr
         };
 
-        cmdBuffer.endSubmit(logicalDevice, graphicsQueue, submitInfo);
+        frame.computeCmdBuffer.endSubmit(logicalDevice, computeQueue, computeSubmitInfo);
+
+        if (display) {
+            // render
+            frame.graphicsCmdBuffer.begin();
+            draw(frame, imageIndex);
+
+            VkSemaphore waitSemaphores[] = {
+                    frame.syncObjects.imageAvailableSemaphore,
+                    frame.computeFinishedSemaphore
+            };
+
+            VkPipelineStageFlags waitStages[] = {
+                    VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT,
+                    VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT
+            };
+
+            VkSubmitInfo graphicsSubmitInfo{
+                    .sType                = VK_STRUCTURE_TYPE_SUBMIT_INFO,
+                    .waitSemaphoreCount   = 2,
+                    .pWaitSemaphores      = waitSemaphores,
+                    .pWaitDstStageMask    = waitStages,
+                    .signalSemaphoreCount = 1,
+                    .pSignalSemaphores    = &frame.syncObjects.renderFinishedSemaphore
+            };
 
-        // Present the swapchain image
-        if (!renderWindow.isMinimized()) {
-            present(imageIndex);
+            frame.graphicsCmdBuffer.endSubmit(logicalDevice, graphicsQueue, graphicsSubmitInfo);
+
+            // Present the swapchain image, recreating the swapchain if the window changed
+            present(frame, imageIndex);
         }
 
+        frameIndex = (frameIndex + 1) % static_cast<uint32_t>(frames.size());
+
         glfwPollEvents();
         clock.markFrame();
     }
 
     vkDeviceWaitIdle(logicalDevice);
+    std::cout << passTimer.summary();
+}
+
+void Raymarcher::runHeadless() {
+    updatePushConsts.getPushConstants().deltaTime = config.headlessTimeStep;
+
+    raymarcher::tools::Clock clock;
+    clock.markFrame();
+
+    for (uint32_t step = 0; step < config.headlessSteps; step++) {
+        FrameResources& frame = frames[frameIndex];
+
+        frame.computeCmdBuffer.wait(logicalDevice);
+        stagingRing.release(frameIndex);
+        agentReadback.complete(frameIndex);
+        populationReadback.complete(frameIndex);
+        passTimer.complete(logicalDevice, frameIndex);
+
+        // the first step has been read back by now. it warms up, and spawns every agent when benchmarking
+        if (step == frames.size()) {
+            passTimer.reset();
+        }
+
+        // snapshot the final state
+        if (config.headlessSnapshot && step + 1 == config.headlessSteps) {
+            requestAgentSnapshot();
+        }
+
+        frame.computeCmdBuffer.begin();
+        stagingRing.flush(frame.computeCmdBuffer.getHandle(), frameIndex);
+
+        recordSimulation(frame, false);
+
+        frame.computeCmdBuffer.endSubmit(logicalDevice, computeQueue);
+        frameIndex = (frameIndex + 1) % static_cast<uint32_t>(frames.size());
+
+        clock.markFrame();
+    }
+
+    vkDeviceWaitIdle(logicalDevice);
+
+    // everything has finished, so every slot's readback is complete
+    for (uint32_t slot = 0; slot < frames.size(); slot++) {
+        agentReadback.complete(slot);
+        populationReadback.complete(slot);
+        passTimer.complete(logicalDevice, slot);
+    }
+
+    std::cout << "Ran " << config.headlessSteps << " headless steps\n" << clock.summary() << passTimer.summary();
+    printAgentSnapshot();
+}
+
+const raymarcher::core::PassTimer& Raymarcher::getPassTimer() const {
+    return passTimer;
+}
+
+bool Raymarcher::isAgentPass(const std::string& pass) const {
+    return agentPasses.contains(pass);
+}
+
+void Raymarcher::requestAgentSnapshot() {
+    agentReadback.request();
+    populationReadback.request();
+}
+
+std::optional<std::vector<Agent>> Raymarcher::takeAgentSnapshot() {
+    // both were recorded by the same frame, so they are ready together
+    std::optional<std::vector<Agent>> agents = agentReadback.take<Agent>();
+    std::optional<std::vector<AgentPopulation>> population = populationReadback.take<AgentPopulation>();
+
+    if (!agents.has_value() || !population.has_value() || population->empty()) {
+        return std::nullopt;
+    }
+
+    agents->resize(std::min<size_t>(population->front().count, agents->size()));
+    return agents;
+}
+
+void Raymarcher::printAgentSnapshot() {
+    std::optional<std::vector<Agent>> agents = takeAgentSnapshot();
+    if (!agents.has_value()) {
+        return;
+    }
+
+    std::cout << "Agent snapshot: " << agents->size() << " agents";
+    if (!agents->empty()) {
+        std::cout << ", first at (" << agents->front().position.x << ", " << agents->front().position.y << ")";
+    }
+    std::cout << "\n";
 }
 
 void Raymarcher::writeDescriptorSets() {
+    pingImageIndex = bindlessTable.addStorageImage(logicalDevice, pingImage);
+    pongImageIndex = bindlessTable.addStorageImage(logicalDevice, pongImage);
+    agentsBufferIndex = bindlessTable.addStorageBuffer(logicalDevice, agentsBuffer.getBuffer());
+    nextAgentsIndex = bindlessTable.addStorageBuffer(logicalDevice, nextAgents.getBuffer());
+    populationIndex = bindlessTable.addStorageBuffer(logicalDevice, populationBuffer.getBuffer());
+    blurWeightsIndex = bindlessTable.addStorageBuffer(logicalDevice, blurWeights.getBuffer());
+
+    if (config.depositMode != DepositMode::STORE) {
+        depositImageIndex = bindlessTable.addStorageImage(logicalDevice, depositImage);
+    }
+
+    if (config.agentSortInterval != 0) {
+        sortCellsIndex = bindlessTable.addStorageBuffer(logicalDevice, sortCells.getBuffer());
+    }
+
+    // the colorize pass writes the display images, the raster pass samples them
+    if (!config.headless) {
+        for (FrameResources& frame : frames) {
+            frame.displayImageIndex = bindlessTable.addStorageImage(logicalDevice, frame.displayImage);
+        }
+    }
 
+    // push descriptor sets are filled while recording, see draw()
+    if (config.headless || rasterDescriptorSet.isPushDescriptorSet()) {
+        return;
+    }
+
+    for (uint32_t slot = 0; slot < frames.size(); slot++) {
+        rasterDescriptorSet.update(logicalDevice, {raymarcher::core::DescriptorInfo::of(frames[slot].displayImage, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL, fragmentImageSampler)}, slot);
+    }
 }
 
-void Raymarcher::runCompute() {
-    const int workgroupWidth = 32;
-    const int workgroupHeight = 8;
+void Raymarcher::buildRenderGraph() {
+    // update senses the trails the last step left and moves the agents, drawagents stamps them into the same
+    //  version in place, directly or through the resolve pass, and the blur produces a new version of the trail map
+    trailResource = renderGraph.importPingPong("trail", pongImage, pongImageIndex, pingImage, pingImageIndex);
+    agentsResource = renderGraph.importPingPongBuffer("agents", agentsBuffer.getBuffer(), agentsBufferIndex, nextAgents.getBuffer(), nextAgentsIndex);
+    populationResource = renderGraph.importBuffer("population", populationBuffer.getBuffer(), populationIndex);
+    blurWeightsResource = renderGraph.importBuffer("blur weights", blurWeights.getBuffer(), blurWeightsIndex);
+    renderGraph.markOutput(trailResource);
+    renderGraph.markOutput(agentsResource);
+    renderGraph.markOutput(populationResource);
+
+    using Usage = raymarcher::core::RenderGraph::Usage;
+
+    // every agent pass is dispatched through the population's arguments, which cover its current count
+    auto dispatchAgents = [this](raymarcher::core::RenderGraph::PassContext& context) {
+        vkCmdDispatchIndirect(context.getCmdBuffer(), context.buffer(populationResource).getHandle(), offsetof(AgentPopulation, dispatchX));
+    };
 
-    const int localSizeX = 256;
+    // the passes below that use it, see isAgentPass()
+    agentPasses = {"sort count", "sort scatter", "update", "drawagents"};
 
-    readImage->transition(cmdBuffer.getHandle(), VK_IMAGE_LAYOUT_GENERAL, VK_ACCESS_SHADER_READ_BIT, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT);
-    writeImage->transition(cmdBuffer.getHandle(), VK_IMAGE_LAYOUT_GENERAL, VK_ACCESS_SHADER_WRITE_BIT, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT);
+    // reorder the agents by the Morton code of their cell before they are updated, see sort.h. the scatter writes the
+    //  next version of the agents, so the sort costs no copy
+    if (config.agentSortInterval != 0) {
+        sortCellsResource = renderGraph.importBuffer("sort cells", sortCells.getBuffer(), sortCellsIndex);
 
-    updateDescriptorSet.writeBinding(logicalDevice, 0, *readImage, VK_IMAGE_LAYOUT_GENERAL, VK_NULL_HANDLE);
-    updateDescriptorSet.writeBinding(logicalDevice, 2, agentsBuffer);
-    updateDescriptorSet.bind(cmdBuffer.getHandle(), VK_PIPELINE_BIND_POINT_COMPUTE, updatePipeline.pipelineLayout);
+        // the image size is the same for every sort pass, the passes fill in the buffers they declared
+        auto pushSortConsts = [this](VkCommandBuffer cmdBuffer, SortPushConsts consts) {
+            consts.width = static_cast<int>(renderWidth);
+            consts.height = static_cast<int>(renderHeight);
 
-    updatePushConsts.getPushConstants().agentCount = static_cast<int>(agentsBuffer.getSize());
+            sortPushConsts.getPushConstants() = consts;
+            sortPushConsts.push(cmdBuffer, sortPipeline.pipelineLayout);
+        };
 
-    updatePushConsts.push(cmdBuffer.getHandle(), updatePipeline.pipelineLayout);
-    vkCmdBindPipeline(cmdBuffer.getHandle(), VK_PIPELINE_BIND_POINT_COMPUTE, updatePipeline.pipeline);
-    vkCmdDispatch(
-            cmdBuffer.getHandle(),
-            (agentsBuffer.getSize() + localSizeX - 1) / localSizeX,
-            1,
-            1
-    );
+        sortPasses.push_back(renderGraph.addPass("sort clear", {{sortCellsResource, Usage::TRANSFER_WRITE}}, [this](raymarcher::core::RenderGraph::PassContext& context) {
+            vkCmdFillBuffer(context.getCmdBuffer(), context.buffer(sortCellsResource).getHandle(), 0, VK_WHOLE_SIZE, 0);
+        }));
+
+        sortPasses.push_back(renderGraph.addPass("sort count", {{populationResource, Usage::INDIRECT_READ}, {populationResource, Usage::STORAGE_READ}, {agentsResource, Usage::STORAGE_READ}, {sortCellsResource, Usage::STORAGE_READ_WRITE}}, [this, pushSortConsts, dispatchAgents](raymarcher::core::RenderGraph::PassContext& context) {
+            pushSortConsts(context.getCmdBuffer(), SortPushConsts{
+                    .scatter = 0,
+                    .populationBuffer = static_cast<int>(context.bufferIndex(populationResource)),
+                    .agentBuffer = static_cast<int>(context.bufferIndex(agentsResource)),
+                    .cellBuffer = static_cast<int>(context.bufferIndex(sortCellsResource))
+            });
+
+            vkCmdBindPipeline(context.getCmdBuffer(), VK_PIPELINE_BIND_POINT_COMPUTE, sortPipeline.pipeline);
+            dispatchAgents(context);
+        }));
+
+        sortPasses.push_back(renderGraph.addPass("sort scan", {{sortCellsResource, Usage::STORAGE_READ_WRITE}}, [this, pushSortConsts](raymarcher::core::RenderGraph::PassContext& context) {
+            pushSortConsts(context.getCmdBuffer(), SortPushConsts{
+                    .cellBuffer = static_cast<int>(context.bufferIndex(sortCellsResource))
+            });
+
+            vkCmdBindPipeline(context.getCmdBuffer(), VK_PIPELINE_BIND_POINT_COMPUTE, sortScanPipeline.pipeline);
+            vkCmdDispatch(context.getCmdBuffer(), 1, 1, 1);
+        }));
+
+        sortPasses.push_back(renderGraph.addPass("sort scatter", {{populationResource, Usage::INDIRECT_READ}, {populationResource, Usage::STORAGE_READ}, {agentsResource, Usage::STORAGE_READ}, {agentsResource, Usage::STORAGE_WRITE}, {sortCellsResource, Usage::STORAGE_READ_WRITE}}, [this, pushSortConsts, dispatchAgents](raymarcher::core::RenderGraph::PassContext& context) {
+            pushSortConsts(context.getCmdBuffer(), SortPushConsts{
+                    .scatter = 1,
+                    .populationBuffer = static_cast<int>(context.bufferIndex(populationResource)),
+                    .agentBuffer = static_cast<int>(context.bufferIndex(agentsResource)),
+                    .sortedBuffer = static_cast<int>(context.outputBufferIndex(agentsResource)),
+                    .cellBuffer = static_cast<int>(context.bufferIndex(sortCellsResource))
+            });
+
+            vkCmdBindPipeline(context.getCmdBuffer(), VK_PIPELINE_BIND_POINT_COMPUTE, sortPipeline.pipeline);
+            dispatchAgents(context);
+        }));
+    }
 
-    // read and write to read image to add the new agent positions
-    readImage->transition(cmdBuffer.getHandle(), VK_IMAGE_LAYOUT_GENERAL, VK_ACCESS_SHADER_WRITE_BIT, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT);
-    drawAgentsDescriptorSet.writeBinding(logicalDevice, 0, *readImage, VK_IMAGE_LAYOUT_GENERAL, VK_NULL_HANDLE);
-    drawAgentsDescriptorSet.writeBinding(logicalDevice, 1, *writeImage, VK_IMAGE_LAYOUT_GENERAL, VK_NULL_HANDLE);
-    updateDescriptorSet.writeBinding(logicalDevice, 2, agentsBuffer);
-    drawAgentsDescriptorSet.bind(cmdBuffer.getHandle(), VK_PIPELINE_BIND_POINT_COMPUTE, drawAgentsPipeline.pipelineLayout);
-
-    drawAgentsPushConsts.getPushConstants().agentCount = static_cast<int>(agentsBuffer.getSize());
-    drawAgentsPushConsts.push(cmdBuffer.getHandle(), drawAgentsPipeline.pipelineLayout);
-
-    vkCmdBindPipeline(cmdBuffer.getHandle(), VK_PIPELINE_BIND_POINT_COMPUTE, drawAgentsPipeline.pipeline);
-    vkCmdDispatch(
-            cmdBuffer.getHandle(),
-            (agentsBuffer.getSize() + localSizeX - 1) / localSizeX,
-            1,
-            1
-    );
+    // the population pass sizes the update dispatch for the current agents plus the ones to spawn, and afterwards
+    //  takes over how many update appended
+    auto addPopulationPass = [this](const std::string& name, int stage) {
+        renderGraph.addPass(name, {{populationResource, Usage::STORAGE_READ_WRITE}}, [this, stage](raymarcher::core::RenderGraph::PassContext& context) {
+            populationPushConsts.getPushConstants() = PopulationPushConsts{
+                    .populationBuffer = static_cast<int>(context.bufferIndex(populationResource)),
+                    .stage = stage,
+                    .spawnRate = config.agentSpawnRate,
+                    .capacity = config.agentCapacity,
+                    .maxGroupsX = agentGroupsX
+            };
+            populationPushConsts.push(context.getCmdBuffer(), populationPipeline.pipelineLayout);
+
+            vkCmdBindPipeline(context.getCmdBuffer(), VK_PIPELINE_BIND_POINT_COMPUTE, populationPipeline.pipeline);
+            vkCmdDispatch(context.getCmdBuffer(), 1, 1, 1);
+        });
+    };
 
-    readImage->transition(cmdBuffer.getHandle(), VK_IMAGE_LAYOUT_GENERAL, VK_ACCESS_SHADER_READ_BIT, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT);
-    writeImage->transition(cmdBuffer.getHandle(), VK_IMAGE_LAYOUT_GENERAL, VK_ACCESS_SHADER_WRITE_BIT, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT);
+    addPopulationPass("population begin", POPULATION_BEGIN_STEP);
+
+    renderGraph.addPass("update", {{populationResource, Usage::INDIRECT_READ}, {populationResource, Usage::STORAGE_READ_WRITE}, {trailResource, Usage::STORAGE_READ}, {agentsResource, Usage::STORAGE_READ}, {agentsResource, Usage::STORAGE_WRITE}}, [this, dispatchAgents](raymarcher::core::RenderGraph::PassContext& context) {
+        updatePushConsts.getPushConstants().seed = static_cast<uint32_t>(simulationStep);
+        updatePushConsts.getPushConstants().readImage = static_cast<int>(context.inputIndex(trailResource));
+        updatePushConsts.getPushConstants().writeImage = static_cast<int>(context.inputIndex(trailResource));
+        updatePushConsts.getPushConstants().agentBuffer = static_cast<int>(context.bufferIndex(agentsResource));
+        updatePushConsts.getPushConstants().nextAgentBuffer = static_cast<int>(context.outputBufferIndex(agentsResource));
+        updatePushConsts.getPushConstants().populationBuffer = static_cast<int>(context.bufferIndex(populationResource));
+        updatePushConsts.push(context.getCmdBuffer(), updatePipeline.pipelineLayout);
+
+        vkCmdBindPipeline(context.getCmdBuffer(), VK_PIPELINE_BIND_POINT_COMPUTE, updatePipeline.pipeline);
+        dispatchAgents(context);
+    });
+
+    addPopulationPass("population end", POPULATION_END_STEP);
+
+    // must match the specialization constants the pipelines were built with
+    const uint32_t groupsX = (renderWidth + config.imageWorkgroupWidth - 1) / config.imageWorkgroupWidth;
+    const uint32_t groupsY = (renderHeight + config.imageWorkgroupHeight - 1) / config.imageWorkgroupHeight;
+
+    // drawagents either stores straight into the trail map, or counts agents in the deposit image, which the resolve
+    //  pass then adds to the trail map
+    const bool countDeposits = config.depositMode != DepositMode::STORE;
+    raymarcher::core::RenderGraph::ResourceId drawTarget = trailResource;
+
+    if (countDeposits) {
+        depositResource = renderGraph.importImage("deposits", depositImage, depositImageIndex);
+        drawTarget = depositResource;
+
+        // only enabled until the first frame has run, see recordSimulation()
+        clearDepositsPass = renderGraph.addPass("clear deposits", {{depositResource, Usage::TRANSFER_WRITE}}, [this](raymarcher::core::RenderGraph::PassContext& context) {
+            VkClearColorValue zero{};
+            VkImageSubresourceRange range{VK_IMAGE_ASPECT_COLOR_BIT, 0, 1, 0, 1};
+            vkCmdClearColorImage(context.getCmdBuffer(), context.output(depositResource).getImage(), VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, &zero, 1, &range);
+        });
+    }
 
-    blurXDescriptorSet.writeBinding(logicalDevice, 0, *readImage, VK_IMAGE_LAYOUT_GENERAL, VK_NULL_HANDLE);
-    blurXDescriptorSet.writeBinding(logicalDevice, 1, *writeImage, VK_IMAGE_LAYOUT_GENERAL, VK_NULL_HANDLE);
+    renderGraph.addPass("drawagents", {{populationResource, Usage::INDIRECT_READ}, {populationResource, Usage::STORAGE_READ}, {agentsResource, Usage::STORAGE_READ}, {drawTarget, Usage::STORAGE_READ_WRITE}}, [this, drawTarget, dispatchAgents](raymarcher::core::RenderGraph::PassContext& context) {
+        drawAgentsPushConsts.getPushConstants().readImage = static_cast<int>(context.inputIndex(drawTarget));
+        drawAgentsPushConsts.getPushConstants().writeImage = static_cast<int>(context.outputIndex(drawTarget));
+        drawAgentsPushConsts.getPushConstants().agentBuffer = static_cast<int>(context.bufferIndex(agentsResource));
+        drawAgentsPushConsts.getPushConstants().populationBuffer = static_cast<int>(context.bufferIndex(populationResource));
+        drawAgentsPushConsts.push(context.getCmdBuffer(), drawAgentsPipeline.pipelineLayout);
+
+        vkCmdBindPipeline(context.getCmdBuffer(), VK_PIPELINE_BIND_POINT_COMPUTE, drawAgentsPipeline.pipeline);
+        dispatchAgents(context);
+    });
+
+    if (countDeposits) {
+        renderGraph.addPass("resolve deposits", {{depositResource, Usage::STORAGE_READ_WRITE}, {trailResource, Usage::STORAGE_READ_WRITE}}, [this, groupsX, groupsY](raymarcher::core::RenderGraph::PassContext& context) {
+            resolveDepositsPushConsts.getPushConstants().trailImage = static_cast<int>(context.outputIndex(trailResource));
+            resolveDepositsPushConsts.getPushConstants().depositImage = static_cast<int>(context.outputIndex(depositResource));
+            resolveDepositsPushConsts.push(context.getCmdBuffer(), resolveDepositsPipeline.pipelineLayout);
+
+            vkCmdBindPipeline(context.getCmdBuffer(), VK_PIPELINE_BIND_POINT_COMPUTE, resolveDepositsPipeline.pipeline);
+            vkCmdDispatch(context.getCmdBuffer(), groupsX, groupsY, 1);
+        });
+    }
 
-    blurXDescriptorSet.bind(cmdBuffer.getHandle(), VK_PIPELINE_BIND_POINT_COMPUTE, blurXPipeline.pipelineLayout);
-    blurXPushConsts.push(cmdBuffer.getHandle(), blurXPipeline.pipelineLayout);
+    if (config.blurMode == BlurMode::GAUSSIAN) {
+        // both blur axes in one pass, through a shared memory tile
+        renderGraph.addPass("blur", {{trailResource, Usage::STORAGE_READ}, {trailResource, Usage::STORAGE_WRITE}, {blurWeightsResource, Usage::STORAGE_READ}}, [this, groupsX, groupsY](raymarcher::core::RenderGraph::PassContext& context) {
+            blurPushConsts.getPushConstants().readImage = static_cast<int>(context.inputIndex(trailResource));
+            blurPushConsts.getPushConstants().writeImage = static_cast<int>(context.outputIndex(trailResource));
+            blurPushConsts.getPushConstants().weightBuffer = static_cast<int>(context.bufferIndex(blurWeightsResource));
+            blurPushConsts.push(context.getCmdBuffer(), blurPipeline.pipelineLayout);
+
+            vkCmdBindPipeline(context.getCmdBuffer(), VK_PIPELINE_BIND_POINT_COMPUTE, blurPipeline.pipeline);
+            vkCmdDispatch(context.getCmdBuffer(), groupsX, groupsY, 1);
+        });
+    } else {
+        // every box pass along one axis, then along the other. each pass is a full image round trip, but costs the
+        //  same for any sigma. one workgroup filters one line
+        std::vector<int> radii = boxRadii(config.blurSigma, config.boxBlurPasses);
+
+        for (int vertical = 0; vertical < 2; vertical++) {
+            const uint32_t groups = vertical ? renderWidth : renderHeight;
+
+            for (int radius : radii) {
+                renderGraph.addPass(vertical ? "boxblur y" : "boxblur x", {{trailResource, Usage::STORAGE_READ}, {trailResource, Usage::STORAGE_WRITE}}, [this, vertical, radius, groups](raymarcher::core::RenderGraph::PassContext& context) {
+                    boxBlurPushConsts.getPushConstants().readImage = static_cast<int>(context.inputIndex(trailResource));
+                    boxBlurPushConsts.getPushConstants().writeImage = static_cast<int>(context.outputIndex(trailResource));
+                    boxBlurPushConsts.getPushConstants().radius = radius;
+                    boxBlurPushConsts.getPushConstants().vertical = vertical;
+                    boxBlurPushConsts.push(context.getCmdBuffer(), blurPipeline.pipelineLayout);
+
+                    vkCmdBindPipeline(context.getCmdBuffer(), VK_PIPELINE_BIND_POINT_COMPUTE, blurPipeline.pipeline);
+                    vkCmdDispatch(context.getCmdBuffer(), groups, 1, 1);
+                });
+            }
+        }
+    }
 
-    vkCmdBindPipeline(cmdBuffer.getHandle(), VK_PIPELINE_BIND_POINT_COMPUTE, blurXPipeline.pipeline);
-    vkCmdDispatch(
-            cmdBuffer.getHandle(),
-            (renderWidth + workgroupWidth - 1) / workgroupWidth,
-            (renderHeight + workgroupHeight - 1) / workgroupHeight,
-            1
-    );
+    // the display image changes with the frame slot, see recordSimulation(). the compute queue may not support
+    //  fragment stages, and the semaphore wait on the graphics queue makes the colorized image visible to the fragment
+    //  shader, so the final barrier only has to change the layout
+    if (!config.headless) {
+        displayResource = renderGraph.importImage("display", frames[0].displayImage, frames[0].displayImageIndex, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL);
+        renderGraph.markOutput(displayResource);
+
+        displayPass = renderGraph.addPass("colorize", {{trailResource, Usage::STORAGE_READ}, {displayResource, Usage::STORAGE_WRITE}}, [this, groupsX, groupsY](raymarcher::core::RenderGraph::PassContext& context) {
+            displayPushConsts.getPushConstants().trailImage = static_cast<int>(context.inputIndex(trailResource));
+            displayPushConsts.getPushConstants().displayImage = static_cast<int>(context.outputIndex(displayResource));
+            displayPushConsts.push(context.getCmdBuffer(), colorizePipeline.pipelineLayout);
+
+            vkCmdBindPipeline(context.getCmdBuffer(), VK_PIPELINE_BIND_POINT_COMPUTE, colorizePipeline.pipeline);
+            vkCmdDispatch(context.getCmdBuffer(), groupsX, groupsY, 1);
+        });
+    }
+
+    // only enabled on frames with a pending snapshot request
+    readbackPass = renderGraph.addPass("readback", {{agentsResource, Usage::TRANSFER_READ}, {populationResource, Usage::TRANSFER_READ}}, [this](raymarcher::core::RenderGraph::PassContext& context) {
+        agentReadback.record(context.getCmdBuffer(), context.buffer(agentsResource), frameIndex);
+        populationReadback.record(context.getCmdBuffer(), context.buffer(populationResource), frameIndex);
+    }, true);
+
+    std::cout << renderGraph.summary();
+}
 
-    std::swap(writeImage, readImage);
+void Raymarcher::recordSimulation(FrameResources& frame, bool display) {
+    // all compute pipelines share computePipelineLayout, so this stays bound across every pass
+    bindlessTable.bind(frame.computeCmdBuffer.getHandle(), VK_PIPELINE_BIND_POINT_COMPUTE, computePipelineLayout);
 
-    readImage->transition(cmdBuffer.getHandle(), VK_IMAGE_LAYOUT_GENERAL, VK_ACCESS_SHADER_READ_BIT, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT);
-    writeImage->transition(cmdBuffer.getHandle(), VK_IMAGE_LAYOUT_GENERAL, VK_ACCESS_SHADER_WRITE_BIT, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT);
+    if (!config.headless) {
+        renderGraph.setImage(displayResource, frame.displayImage, frame.displayImageIndex);
+        renderGraph.setEnabled(displayPass, display);
+    }
 
-    blurYDescriptorSet.writeBinding(logicalDevice, 0, *readImage, VK_IMAGE_LAYOUT_GENERAL, VK_NULL_HANDLE);
-    blurYDescriptorSet.writeBinding(logicalDevice, 1, *writeImage, VK_IMAGE_LAYOUT_GENERAL, VK_NULL_HANDLE);
+    if (config.depositMode != DepositMode::STORE) {
+        renderGraph.setEnabled(clearDepositsPass, !depositsCleared);
+        depositsCleared = true;
+    }
 
-    blurYDescriptorSet.bind(cmdBuffer.getHandle(), VK_PIPELINE_BIND_POINT_COMPUTE, blurYPipeline.pipelineLayout);
-    blurYPushConsts.push(cmdBuffer.getHandle(), blurYPipeline.pipelineLayout);
+    const bool sort = config.agentSortInterval != 0 && simulationStep % config.agentSortInterval == 0;
+    for (raymarcher::core::RenderGraph::PassId pass : sortPasses) {
+        renderGraph.setEnabled(pass, sort);
+    }
 
-    vkCmdBindPipeline(cmdBuffer.getHandle(), VK_PIPELINE_BIND_POINT_COMPUTE, blurYPipeline.pipeline);
-    vkCmdDispatch(
-            cmdBuffer.getHandle(),
-            (renderWidth + workgroupWidth - 1) / workgroupWidth,
-            (renderHeight + workgroupHeight - 1) / workgroupHeight,
-            1
-    );
+    renderGraph.setEnabled(readbackPass, agentReadback.isRequested());
 
-    std::swap(writeImage, readImage);
+    if (passTimer.isEnabled()) {
+        passTimer.begin(frame.computeCmdBuffer.getHandle(), frameIndex);
+        renderGraph.execute(frame.computeCmdBuffer.getHandle(), &passTimer);
+    } else {
+        renderGraph.execute(frame.computeCmdBuffer.getHandle());
+    }
+
+    simulationStep++;
 }
 
-void Raymarcher::draw(uint32_t& imageIndex) {
-    VkResult result = vkAcquireNextImageKHR(logicalDevice, swapchainObjects.swapchain, UINT64_MAX, syncObjects.imageAvailableSemaphore, VK_NULL_HANDLE, &imageIndex);
+bool Raymarcher::acquire(FrameResources& frame, uint32_t& imageIndex) {
+    VkResult result = vkAcquireNextImageKHR(logicalDevice, swapchainObjects.swapchain, UINT64_MAX, frame.syncObjects.imageAvailableSemaphore, VK_NULL_HANDLE, &imageIndex);
 
-    if (result == VK_ERROR_OUT_OF_DATE_KHR || result == VK_SUBOPTIMAL_KHR) {
-        throw std::runtime_error("Swapchain is either out of date or suboptimal");
-    } else if (result != VK_SUCCESS) {
+    // the semaphore is not signaled when out of date, so skip displaying this frame. suboptimal images can still be
+    //  presented, and the swapchain is recreated after present()
+    if (result == VK_ERROR_OUT_OF_DATE_KHR) {
+        recreateSwapchain();
+        return false;
+    } else if (result != VK_SUCCESS && result != VK_SUBOPTIMAL_KHR) {
         throw std::runtime_error("Failed to acquire swapchain image");
     }
 
-    VkClearValue clearColor = {{0, 0, 0, 1}};
+    return true;
+}
 
-    readImage->transition(cmdBuffer.getHandle(), VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL, VK_ACCESS_SHADER_READ_BIT, VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT);
+void Raymarcher::draw(FrameResources& frame, uint32_t imageIndex) {
+    VkClearValue clearColor = {{0, 0, 0, 1}};
 
     VkRenderPassBeginInfo renderPassBeginInfo{
             .sType = VK_STRUCTURE_TYPE_RENDER_PASS_BEGIN_INFO,
@@ -328,83 +1055,172 @@ void Raymarcher::draw(uint32_t& imageIndex) {
             .pClearValues = &clearColor
     };
 
-    vkCmdBeginRenderPass(cmdBuffer.getHandle(), &renderPassBeginInfo, VK_SUBPASS_CONTENTS_INLINE);
-    rasterDescriptorSet.writeBinding(logicalDevice,0, *readImage, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL, fragmentImageSampler);
+    vkCmdBeginRenderPass(frame.graphicsCmdBuffer.getHandle(), &renderPassBeginInfo, VK_SUBPASS_CONTENTS_INLINE);
+    if (rasterDescriptorSet.isPushDescriptorSet()) {
+        rasterDescriptorSet.push(
+                frame.graphicsCmdBuffer.getHandle(), VK_PIPELINE_BIND_POINT_GRAPHICS, rasterPipeline.pipelineLayout,
+                {raymarcher::core::DescriptorInfo::of(frame.displayImage, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL, fragmentImageSampler)}
+        );
+    } else {
+        // frame is frames[frameIndex], whose display image the set at frameIndex was written with
+        rasterDescriptorSet.bind(frame.graphicsCmdBuffer.getHandle(), VK_PIPELINE_BIND_POINT_GRAPHICS, rasterPipeline.pipelineLayout, frameIndex);
+    }
 
-    rasterDescriptorSet.bind(cmdBuffer.getHandle(), VK_PIPELINE_BIND_POINT_GRAPHICS, rasterPipeline.pipelineLayout);
+    vkCmdBindPipeline(frame.graphicsCmdBuffer.getHandle(), VK_PIPELINE_BIND_POINT_GRAPHICS, rasterPipeline.pipeline);
+
+    // fit the simulation into the window without distorting it. the rest of the window keeps the clear color
+    const VkExtent2D extent = swapchainObjects.swapchainExtent;
+    const float scale = std::min(
+            static_cast<float>(extent.width) / static_cast<float>(renderWidth),
+            static_cast<float>(extent.height) / static_cast<float>(renderHeight)
+    );
 
-    vkCmdBindPipeline(cmdBuffer.getHandle(), VK_PIPELINE_BIND_POINT_GRAPHICS, rasterPipeline.pipeline);
+    const float viewportWidth = static_cast<float>(renderWidth) * scale;
+    const float viewportHeight = static_cast<float>(renderHeight) * scale;
 
     VkViewport viewport{
-            .x = 0,
-            .y = 0,
-            .width = static_cast<float>(swapchainObjects.swapchainExtent.width),
-            .height = static_cast<float>(swapchainObjects.swapchainExtent.height),
+            .x = (static_cast<float>(extent.width) - viewportWidth) / 2,
+            .y = (static_cast<float>(extent.height) - viewportHeight) / 2,
+            .width = viewportWidth,
+            .height = viewportHeight,
             .minDepth = 0,
             .maxDepth = 1
     };
-    vkCmdSetViewport(cmdBuffer.getHandle(), 0, 1, &viewport);
+    vkCmdSetViewport(frame.graphicsCmdBuffer.getHandle(), 0, 1, &viewport);
 
     VkRect2D scissor{
             .offset = {0, 0},
-            .extent = swapchainObjects.swapchainExtent
+            .extent = extent
     };
 
-    vkCmdSetScissor(cmdBuffer.getHandle(), 0, 1, &scissor);
-    vkCmdDraw(cmdBuffer.getHandle(), 6, 1, 0, 0);
-    vkCmdEndRenderPass(cmdBuffer.getHandle());
+    vkCmdSetScissor(frame.graphicsCmdBuffer.getHandle(), 0, 1, &scissor);
+    vkCmdDraw(frame.graphicsCmdBuffer.getHandle(), 6, 1, 0, 0);
+    vkCmdEndRenderPass(frame.graphicsCmdBuffer.getHandle());
 }
 
-void Raymarcher::present(uint32_t imageIndex) {
+void Raymarcher::present(FrameResources& frame, uint32_t imageIndex) {
     VkPresentInfoKHR presentInfo{};
     presentInfo.sType = VK_STRUCTURE_TYPE_PRESENT_INFO_KHR;
 
     presentInfo.waitSemaphoreCount = 1;
-    presentInfo.pWaitSemaphores = &syncObjects.renderFinishedSemaphore;
+    presentInfo.pWaitSemaphores = &frame.syncObjects.renderFinishedSemaphore;
 
     presentInfo.swapchainCount = 1;
     presentInfo.pSwapchains = &swapchainObjects.swapchain;
     presentInfo.pImageIndices = &imageIndex;
 
-    vkQueuePresentKHR(presentQueue, &presentInfo);
+    VkResult result = vkQueuePresentKHR(presentQueue, &presentInfo);
+
+    // not every platform reports a resize through the present result, so also check the window
+    bool resized = renderWindow.pollResized();
+    if (result == VK_ERROR_OUT_OF_DATE_KHR || result == VK_SUBOPTIMAL_KHR || resized) {
+        recreateSwapchain();
+    } else if (result != VK_SUCCESS) {
+        throw std::runtime_error("Failed to present swapchain image");
+    }
 }
 
-Raymarcher::~Raymarcher() {
+void Raymarcher::recreateSwapchain() {
+    renderWindow.pollResized();
+
+    // a minimized window has no extent to create a swapchain for. the render loop skips displaying until it is restored
+    if (renderWindow.isMinimized()) {
+        return;
+    }
+
+    // the framebuffers and image views may still be used by frames in flight
+    vkDeviceWaitIdle(logicalDevice);
+
+    // keep the old swapchain alive until the new one is created from it
+    VkSwapchainKHR oldSwapchain = swapchainObjects.swapchain;
+    VkFormat oldFormat = swapchainObjects.swapchainImageFormat;
+
+    swapchainObjects.swapchain = VK_NULL_HANDLE;
+    destroySwapchain();
+
+    swapchainObjects = vktools::createSwapchain(surface, physicalDevice, logicalDevice, renderWindow.getWidth(), renderWindow.getHeight(), oldSwapchain);
+    vkDestroySwapchainKHR(logicalDevice, oldSwapchain, nullptr);
+
+    // the render pass, and with it the display pipeline, only depend on the format, which does not change on resize
+    if (swapchainObjects.swapchainImageFormat != oldFormat) {
+        throw std::runtime_error("Swapchain format changed while recreating the swapchain");
+    }
+
+    swapchainImageViews = vktools::createSwapchainImageViews(logicalDevice, swapchainObjects.swapchainImageFormat, swapchainObjects.swapchainImages);
+    framebuffers = vktools::createSwapchainFramebuffers(logicalDevice, renderPass, swapchainObjects.swapchainExtent, swapchainImageViews);
+}
+
+void Raymarcher::destroySwapchain() {
     for (VkFramebuffer framebuffer : framebuffers) {
         vkDestroyFramebuffer(logicalDevice, framebuffer, nullptr);
     }
 
+    for (VkImageView imageView : swapchainImageViews) {
+        vkDestroyImageView(logicalDevice, imageView, nullptr);
+    }
+
+    framebuffers.clear();
+    swapchainImageViews.clear();
+
+    vkDestroySwapchainKHR(logicalDevice, swapchainObjects.swapchain, nullptr);
+    swapchainObjects.swapchain = VK_NULL_HANDLE;
+}
+
+Raymarcher::~Raymarcher() {
     pingImage.destroy(logicalDevice);
     pongImage.destroy(logicalDevice);
+    depositImage.destroy(logicalDevice);
 
-    stagingBuffer.destroy(logicalDevice);
+    stagingRing.destroy(logicalDevice);
+    agentReadback.destroy(logicalDevice);
+    populationReadback.destroy(logicalDevice);
+    passTimer.destroy(logicalDevice);
     agentsBuffer.destroy(logicalDevice);
+    nextAgents.destroy(logicalDevice);
+    populationBuffer.destroy(logicalDevice);
+    sortCells.destroy(logicalDevice);
+    blurWeights.destroy(logicalDevice);
 
     vkDestroySampler(logicalDevice, fragmentImageSampler, nullptr);
-    cmdBuffer.destroy(logicalDevice);
     vkDestroyRenderPass(logicalDevice, renderPass, nullptr);
-    updateDescriptorSet.destroy(logicalDevice);
-    blurXDescriptorSet.destroy(logicalDevice);
-    blurYDescriptorSet.destroy(logicalDevice);
+
+    for (FrameResources& frame : frames) {
+        frame.computeCmdBuffer.destroy(logicalDevice);
+        frame.graphicsCmdBuffer.destroy(logicalDevice);
+        frame.displayImage.destroy(logicalDevice);
+        vkDestroySemaphore(logicalDevice, frame.computeFinishedSemaphore, nullptr);
+        vkDestroySemaphore(logicalDevice, frame.syncObjects.renderFinishedSemaphore, nullptr);
+        vkDestroySemaphore(logicalDevice, frame.syncObjects.imageAvailableSemaphore, nullptr);
+    }
+
+    bindlessTable.destroy(logicalDevice);
     rasterDescriptorSet.destroy(logicalDevice);
-    vkDestroySemaphore(logicalDevice, syncObjects.renderFinishedSemaphore, nullptr);
-    vkDestroySemaphore(logicalDevice, syncObjects.imageAvailableSemaphore, nullptr);
+    descriptorAllocator.destroy(logicalDevice);
+
     vkDestroyPipeline(logicalDevice, rasterPipeline.pipeline, nullptr);
-    vkDestroyPipeline(logicalDevice, blurXPipeline.pipeline, nullptr);
-    vkDestroyPipeline(logicalDevice, blurYPipeline.pipeline, nullptr);
+    vkDestroyPipeline(logicalDevice, blurPipeline.pipeline, nullptr);
+    vkDestroyPipeline(logicalDevice, colorizePipeline.pipeline, nullptr);
     vkDestroyPipeline(logicalDevice, updatePipeline.pipeline, nullptr);
-    vkDestroyPipelineLayout(logicalDevice, updatePipeline.pipelineLayout, nullptr);
+    vkDestroyPipeline(logicalDevice, drawAgentsPipeline.pipeline, nullptr);
+    vkDestroyPipeline(logicalDevice, populationPipeline.pipeline, nullptr);
+    vkDestroyPipeline(logicalDevice, resolveDepositsPipeline.pipeline, nullptr);
+    vkDestroyPipeline(logicalDevice, sortPipeline.pipeline, nullptr);
+    vkDestroyPipeline(logicalDevice, sortScanPipeline.pipeline, nullptr);
+    vkDestroyPipelineLayout(logicalDevice, computePipelineLayout, nullptr);  // shared by every compute pipeline
     vkDestroyPipelineLayout(logicalDevice, rasterPipeline.pipelineLayout, nullptr);
-    vkDestroyPipelineLayout(logicalDevice, blurXPipeline.pipelineLayout, nullptr);
-    vkDestroyPipelineLayout(logicalDevice, blurYPipeline.pipelineLayout, nullptr);
 
-    vkDestroyCommandPool(logicalDevice, commandPool, nullptr);
+    vkDestroyCommandPool(logicalDevice, computeCommandPool, nullptr);
+    vkDestroyCommandPool(logicalDevice, graphicsCommandPool, nullptr);
 
-    for (VkImageView imageView : swapchainImageViews) {
-        vkDestroyImageView(logicalDevice, imageView, nullptr);
-    }
+    pipelineCache.save(logicalDevice);
+    pipelineCache.destroy(logicalDevice);
 
-    vkDestroySwapchainKHR(logicalDevice, swapchainObjects.swapchain, nullptr);
+    // every buffer and image has been destroyed by now
+    memoryAllocator.destroy(logicalDevice);
+
+    if (!config.headless) {
+        destroySwapchain();
+    }
 
     vkDestroyDevice(logicalDevice, nullptr);
 
@@ -414,5 +1230,8 @@ Raymarcher::~Raymarcher() {
 
     vkDestroySurfaceKHR(instance, surface, nullptr);
     vkDestroyInstance(instance, nullptr);
-    renderWindow.destroy();
+
+    if (!config.headless) {
+        renderWindow.destroy();
+    }
 }
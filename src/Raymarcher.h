@@ -3,72 +3,246 @@
 
 #include <vector>
 #include <optional>
+#include <set>
+#include <string>
 #include <vulkan/vulkan_core.h>
 
 #include "tools/vktools.h"
 #include "core/Buffer.h"
 #include "core/CmdBuffer.h"
+#include "core/DescriptorAllocator.h"
+#include "core/BindlessTable.h"
+#include "core/RenderGraph.h"
+#include "core/StagingRing.h"
+#include "core/AsyncReadback.h"
+#include "core/TypedBuffer.h"
+#include "core/PassTimer.h"
 #include "window/Window.h"
 #include "graphics/Camera.h"
 #include "tools/Clock.h"
 
 #include "../polyglot/common.h"
 #include "../polyglot/update.h"
+#include "../polyglot/blur.h"
+#include "../polyglot/trail.h"
+#include "../polyglot/deposit.h"
+#include "../polyglot/sort.h"
+#include "../polyglot/specialization.h"
+
+enum class BlurMode {
+    GAUSSIAN,  // one fused pass, taps grow with sigma up to BLUR_MAX_RADIUS
+    BOX  // repeated running sum box filters, the cost does not depend on sigma
+};
+
+enum class DepositMode {
+    STORE,  // agents sharing a pixel deposit once
+    ATOMIC,  // every agent counts, one global atomic each
+    HISTOGRAM  // every agent counts, binned per workgroup in shared memory before the global atomics
+};
+
+struct RaymarcherConfig {
+    /**
+     * When true no window, surface, swapchain or display pipeline is created. The simulation runs for
+     * headlessSteps steps as fast as the device allows and then returns from renderLoop().
+     */
+    bool headless = false;
+    uint32_t headlessSteps = 1000;
+
+    // fixed time step used by headless runs so batch results do not depend on how fast the device is
+    float headlessTimeStep = 1.0f / 60.0f;
+
+    // copy the agents back after a headless run. needs a host visible buffer of agentCapacity agents
+    bool headlessSnapshot = true;
+
+    // time every render graph pass with GPU timestamps, see PassTimer. printed when the run ends
+    bool timePasses = false;
+
+    // Kernel tunables, passed to the shaders as specialization constants so they can change without recompiling
+    //  the SPIR-V. Workgroup sizes are checked against the device limits at startup.
+    uint32_t agentWorkgroupSize = 256;  // 1D, used by update and drawagents
+    uint32_t imageWorkgroupWidth = 32;  // 2D, used by the blur
+    uint32_t imageWorkgroupHeight = 8;
+    float agentSpeed = 30.0f;
+    float blurSigma = 0.5f;  // turned into kernel weights on the host. the Gaussian blur takes up to BLUR_MAX_RADIUS / 3
+    BlurMode blurMode = BlurMode::GAUSSIAN;
+    uint32_t boxBlurPasses = 3;  // box filters per axis. three are close to a Gaussian
+
+    // single channel format of the trail map: R16_SFLOAT, R32_SFLOAT or R32_UINT (fixed point, see trail.h)
+    VkFormat trailFormat = VK_FORMAT_R16_SFLOAT;
+    DepositMode depositMode = DepositMode::STORE;
+
+    // steps between reordering the agents by where they are, so neighboring invocations touch neighboring pixels.
+    //  0 never sorts. agent snapshots come out in the sorted order
+    uint32_t agentSortInterval = 16;
+
+    // the agent count lives on the GPU and changes without the host reading it back. each step spawns agentSpawnRate
+    //  agents anywhere on the image while there is room for them, and agents older than agentLifetime seconds are
+    //  dropped. the capacity is checked against the device's dispatch and storage buffer limits at startup
+    uint32_t agentCapacity = 1 << 16;
+    uint32_t agentSpawnRate = 0;
+    float agentLifetime = 0.0f;  // 0 lets agents live forever
+
+    // resolution of the simulation images, independent of the window. the display pass scales it to fit the window
+    //  while keeping its aspect ratio
+    uint32_t simulationWidth = 800;
+    uint32_t simulationHeight = 800;
+
+    // initial window size. the window can be resized freely afterwards
+    int windowWidth = 800;
+    int windowHeight = 800;
+
+    // how many frames the CPU may record ahead of the GPU. each frame slot has its own command buffer and sync objects
+    uint32_t framesInFlight = 2;
+};
 
 class Raymarcher {
 public:
-    Raymarcher();
+    explicit Raymarcher(const RaymarcherConfig& config = {});
     void renderLoop();
     ~Raymarcher();
 
+    /**
+     * Ask for a copy of the agents at the end of the next simulation step. The copy is made on the GPU and does not
+     * stall the frame. takeAgentSnapshot() returns it once that frame has finished, and nullopt until then.
+     */
+    void requestAgentSnapshot();
+    std::optional<std::vector<Agent>> takeAgentSnapshot();
+
+    // GPU time per pass, when config.timePasses is set
+    [[nodiscard]] const raymarcher::core::PassTimer& getPassTimer() const;
+
+    // whether the pass dispatches one invocation per agent, as opposed to one per pixel
+    [[nodiscard]] bool isAgentPass(const std::string& pass) const;
+
+    /**
+     * Check config against the device's limits without creating anything on it, so that callers trying several
+     * configs can skip the ones that do not fit before a Raymarcher allocates anything. Throws std::runtime_error
+     * naming the limit, the constructor runs the same check.
+     */
+    static void checkDeviceLimits(const RaymarcherConfig& config, VkPhysicalDevice physicalDevice);
+
+    // whether the simulation queue can write the timestamps config.timePasses needs
+    [[nodiscard]] static bool supportsPassTiming(VkPhysicalDevice physicalDevice);
+
 private:
+    /**
+     * Everything that is used by one frame in flight. A slot is only reused once its command buffer's fence has
+     * signaled, so nothing in here can be in use by the GPU while the CPU records into it.
+     */
+    struct FrameResources {
+        raymarcher::core::CmdBuffer computeCmdBuffer;  // simulation passes, on the compute queue
+        raymarcher::core::CmdBuffer graphicsCmdBuffer;  // display pass, on the graphics queue
+        vktools::SyncObjects syncObjects;
+        VkSemaphore computeFinishedSemaphore = VK_NULL_HANDLE;
+
+        // the simulation result is colorized into here for display, so the next simulation step can write the
+        //  ping/pong images while this frame is still being drawn
+        raymarcher::graphics::Image displayImage;
+        uint32_t displayImageIndex = 0;  // in the bindless table
+    };
+
+    void runHeadless();
+    void printAgentSnapshot();
     void writeDescriptorSets();
-    void runCompute();
-    void draw(uint32_t& imageIndex);
-    void present(uint32_t imageIndex);
+    void buildRenderGraph();
+    void recordSimulation(FrameResources& frame, bool display);
+    bool acquire(FrameResources& frame, uint32_t& imageIndex);
+    void draw(FrameResources& frame, uint32_t imageIndex);
+    void present(FrameResources& frame, uint32_t imageIndex);
+    void recreateSwapchain();
+    void destroySwapchain();
 
+    RaymarcherConfig config;
     uint32_t renderWidth, renderHeight;
-    int windowWidth, windowHeight;
-    VkQueue graphicsQueue;
-    VkQueue presentQueue;
+    VkQueue graphicsQueue = VK_NULL_HANDLE;
+    VkQueue computeQueue = VK_NULL_HANDLE;  // same as the graphics queue unless the device has an async compute family
+    VkQueue presentQueue = VK_NULL_HANDLE;
     std::vector<raymarcher::graphics::Shader> shaders;
-    raymarcher::core::PushConstants<ComputePushConsts> blurXPushConsts;
-    raymarcher::core::PushConstants<ComputePushConsts> blurYPushConsts;
+    raymarcher::core::PushConstants<BlurPushConsts> blurPushConsts;
+    raymarcher::core::PushConstants<BoxBlurPushConsts> boxBlurPushConsts;
+    raymarcher::core::PushConstants<DisplayPushConsts> displayPushConsts;
     raymarcher::core::PushConstants<UpdatePushConsts> updatePushConsts;
     raymarcher::core::PushConstants<UpdatePushConsts> drawAgentsPushConsts;
+    raymarcher::core::PushConstants<DepositPushConsts> resolveDepositsPushConsts;
+    raymarcher::core::PushConstants<SortPushConsts> sortPushConsts;
+    raymarcher::core::PushConstants<PopulationPushConsts> populationPushConsts;
     raymarcher::graphics::Camera camera;
     raymarcher::window::Window renderWindow;
     VkInstance instance;
+    VkPhysicalDevice physicalDevice = VK_NULL_HANDLE;
+    vktools::DeviceCapabilities capabilities;
     VkDevice logicalDevice;
     std::vector<VkFramebuffer> framebuffers;
     raymarcher::graphics::Image pingImage;
     raymarcher::graphics::Image pongImage;
+    raymarcher::graphics::Image depositImage;  // R32_UINT agent counts, unless config.depositMode is STORE
 
-    raymarcher::graphics::Image* writeImage;
-    raymarcher::graphics::Image* readImage;
+    // the simulation passes and the colorize pass for display. the graph decides which of ping and pong is read
+    raymarcher::core::RenderGraph renderGraph;
+    raymarcher::core::RenderGraph::ResourceId trailResource = 0;
+    raymarcher::core::RenderGraph::ResourceId agentsResource = 0;
+    raymarcher::core::RenderGraph::ResourceId blurWeightsResource = 0;
+    raymarcher::core::RenderGraph::ResourceId depositResource = 0;
+    raymarcher::core::RenderGraph::ResourceId populationResource = 0;
+    raymarcher::core::RenderGraph::ResourceId sortCellsResource = 0;
+    raymarcher::core::RenderGraph::ResourceId displayResource = 0;
+    raymarcher::core::RenderGraph::PassId displayPass = 0;
+    raymarcher::core::RenderGraph::PassId readbackPass = 0;
+    raymarcher::core::RenderGraph::PassId clearDepositsPass = 0;
+    bool depositsCleared = false;  // the resolve pass clears what it reads, only the first frame needs the clear pass
+    std::vector<raymarcher::core::RenderGraph::PassId> sortPasses;  // enabled every config.agentSortInterval steps
+    std::set<std::string> agentPasses;  // see isAgentPass()
+    uint64_t simulationStep = 0;
+    uint32_t agentGroupsX = 0;  // workgroups per row of an agent dispatch, see update.h
+    raymarcher::core::PassTimer passTimer;
 
-    raymarcher::core::Buffer stagingBuffer;
-    raymarcher::core::CmdBuffer cmdBuffer;
-    raymarcher::core::DescriptorSet blurXDescriptorSet;
-    raymarcher::core::DescriptorSet blurYDescriptorSet;
-    raymarcher::core::DescriptorSet updateDescriptorSet;
+    // filled once by writeDescriptorSets() and only bound while recording. the compute passes address the ping/pong
+    //  images and agents by their index in the bindless table, the raster set holds one set per frame slot
+    raymarcher::core::DescriptorAllocator descriptorAllocator;
+    raymarcher::core::BindlessTable bindlessTable;
+    uint32_t pingImageIndex = 0;
+    uint32_t pongImageIndex = 0;
+    uint32_t agentsBufferIndex = 0;
+    uint32_t blurWeightsIndex = 0;
+    uint32_t depositImageIndex = 0;
+    uint32_t nextAgentsIndex = 0;
+    uint32_t populationIndex = 0;
+    uint32_t sortCellsIndex = 0;
+    VkPipelineLayout computePipelineLayout = VK_NULL_HANDLE;
     raymarcher::core::DescriptorSet rasterDescriptorSet;
-    raymarcher::core::DescriptorSet drawAgentsDescriptorSet;
-    vktools::SyncObjects syncObjects;
-    VkSampler fragmentImageSampler;
-    VkRenderPass renderPass;
+
+    std::vector<FrameResources> frames;
+    uint32_t frameIndex = 0;
+    VkSampler fragmentImageSampler = VK_NULL_HANDLE;
+    VkRenderPass renderPass = VK_NULL_HANDLE;
+    raymarcher::core::PipelineCache pipelineCache;
+    raymarcher::core::MemoryAllocator memoryAllocator;
+    raymarcher::core::StagingRing stagingRing;  // all host to device uploads, flushed at the start of each frame
     vktools::PipelineInfo rasterPipeline;
-    vktools::PipelineInfo blurXPipeline;
-    vktools::PipelineInfo blurYPipeline;
+    vktools::PipelineInfo blurPipeline;  // blur.comp or boxblur.comp, depending on config.blurMode
+    vktools::PipelineInfo colorizePipeline;
     vktools::PipelineInfo updatePipeline;
     vktools::PipelineInfo drawAgentsPipeline;
-    raymarcher::core::Buffer agentsBuffer;
+    vktools::PipelineInfo resolveDepositsPipeline;
+    vktools::PipelineInfo sortPipeline;  // counts and scatters, see morton.comp
+    vktools::PipelineInfo sortScanPipeline;
+    vktools::PipelineInfo populationPipeline;
+    // ping/pong agent buffers of config.agentCapacity agents. update and the sort write the live ones to the other
+    //  buffer, populationBuffer counts them
+    raymarcher::core::TypedBuffer<Agent> agentsBuffer;
+    raymarcher::core::TypedBuffer<Agent> nextAgents;
+    raymarcher::core::TypedBuffer<AgentPopulation> populationBuffer;
+    raymarcher::core::TypedBuffer<uint32_t> sortCells;  // agents per cell, then their offsets
+    raymarcher::core::AsyncReadback agentReadback;
+    raymarcher::core::AsyncReadback populationReadback;  // requested with agentReadback, to tell the live agents apart
+    raymarcher::core::TypedBuffer<float> blurWeights;  // see gaussianWeights(), uploaded once
 
-    VkCommandPool commandPool;
+    VkCommandPool computeCommandPool = VK_NULL_HANDLE;
+    VkCommandPool graphicsCommandPool = VK_NULL_HANDLE;
     std::vector<VkImageView> swapchainImageViews;
     vktools::SwapchainObjects swapchainObjects;
     std::optional<VkDebugUtilsMessengerEXT> debugMessenger;
-    VkSurfaceKHR surface;
+    VkSurfaceKHR surface = VK_NULL_HANDLE;
 };
 
 
@@ -0,0 +1,60 @@
+#include "AsyncReadback.h"
+#include "BarrierBatch.h"
+
+#include <algorithm>
+
+raymarcher::core::AsyncReadback::AsyncReadback(VkDevice logicalDevice, MemoryAllocator& allocator, VkDeviceSize size) {
+    buffer = Buffer{
+            logicalDevice, allocator, size,
+            VK_BUFFER_USAGE_TRANSFER_DST_BIT,
+            static_cast<VkMemoryAllocateFlags>(0),
+            VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT
+    };
+}
+
+void raymarcher::core::AsyncReadback::request() {
+    if (state == State::IDLE || state == State::READY) {
+        state = State::REQUESTED;
+    }
+}
+
+void raymarcher::core::AsyncReadback::record(VkCommandBuffer cmdBuffer, const Buffer& src, uint32_t frameSlot) {
+    if (state != State::REQUESTED) {
+        return;
+    }
+
+    VkBufferCopy region{
+            .srcOffset = 0,
+            .dstOffset = 0,
+            .size = std::min(src.getSize(), buffer.getSize())
+    };
+
+    vkCmdCopyBuffer(cmdBuffer, src.getHandle(), buffer.getHandle(), 1, &region);
+
+    // the fence makes device writes available, but the host read still needs to be in the barrier's scope
+    BarrierBatch barriers;
+    barriers.buffer(buffer, VK_PIPELINE_STAGE_2_COPY_BIT, VK_ACCESS_2_TRANSFER_WRITE_BIT, VK_PIPELINE_STAGE_2_HOST_BIT, VK_ACCESS_2_HOST_READ_BIT);
+    barriers.flush(cmdBuffer);
+
+    state = State::IN_FLIGHT;
+    recordedFrameSlot = frameSlot;
+}
+
+void raymarcher::core::AsyncReadback::complete(uint32_t frameSlot) {
+    if (state == State::IN_FLIGHT && recordedFrameSlot == frameSlot) {
+        state = State::READY;
+    }
+}
+
+bool raymarcher::core::AsyncReadback::isRequested() const {
+    return state == State::REQUESTED;
+}
+
+bool raymarcher::core::AsyncReadback::isReady() const {
+    return state == State::READY;
+}
+
+void raymarcher::core::AsyncReadback::destroy(VkDevice logicalDevice) {
+    buffer.destroy(logicalDevice);
+    state = State::IDLE;
+}
@@ -0,0 +1,70 @@
+#ifndef RAYMARCH_ASYNCREADBACK_H
+#define RAYMARCH_ASYNCREADBACK_H
+
+#include <vulkan/vulkan.h>
+
+#include <vector>
+#include <optional>
+#include <cstring>
+#include <cstdint>
+
+#include "Buffer.h"
+#include "MemoryAllocator.h"
+
+namespace raymarcher::core {
+    /**
+     * Copies a device local buffer into host visible memory on request, without stalling the frame. A request is
+     * recorded into the next frame's command buffer and completes when that frame slot's fence has signaled, after
+     * which take() returns the snapshot. At most one snapshot is in flight at a time.
+     */
+    class AsyncReadback {
+    public:
+        AsyncReadback() = default;
+        AsyncReadback(VkDevice logicalDevice, MemoryAllocator& allocator, VkDeviceSize size);
+
+        // ask for a snapshot. ignored while another one is still pending
+        void request();
+
+        /**
+         * Record the copy if a snapshot was requested. The caller orders it after the writes to src, e.g. by recording
+         * it as a render graph pass that reads src.
+         * @param frameSlot The frame slot cmdBuffer belongs to.
+         */
+        void record(VkCommandBuffer cmdBuffer, const Buffer& src, uint32_t frameSlot);
+
+        /**
+         * Mark the snapshot as ready if it was recorded by frameSlot. Only call this after waiting on that slot's fences.
+         */
+        void complete(uint32_t frameSlot);
+
+        // true while a request waits to be recorded
+        [[nodiscard]] bool isRequested() const;
+        [[nodiscard]] bool isReady() const;
+
+        template<typename T>
+        std::optional<std::vector<T>> take() {
+            if (state != State::READY) {
+                return std::nullopt;
+            }
+
+            state = State::IDLE;
+            return buffer.copyToHost<T>();
+        }
+
+        void destroy(VkDevice logicalDevice);
+
+    private:
+        enum class State {
+            IDLE,
+            REQUESTED,
+            IN_FLIGHT,
+            READY
+        };
+
+        Buffer buffer;
+        State state = State::IDLE;
+        uint32_t recordedFrameSlot = 0;
+    };
+}
+
+#endif //RAYMARCH_ASYNCREADBACK_H
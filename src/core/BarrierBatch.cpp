@@ -0,0 +1,94 @@
+#include "BarrierBatch.h"
+
+#include <algorithm>
+
+void raymarcher::core::BarrierBatch::image(raymarcher::graphics::Image& image, VkImageLayout newLayout, VkAccessFlags2 accessMask, VkPipelineStageFlags2 stages) {
+    std::optional<VkImageMemoryBarrier2> barrier = image.barrierTo(newLayout, accessMask, stages);
+
+    if (barrier.has_value()) {
+        this->image(barrier.value());
+    }
+}
+
+void raymarcher::core::BarrierBatch::image(const VkImageMemoryBarrier2& barrier) {
+    auto pending = std::find_if(imageBarriers.begin(), imageBarriers.end(), [&](const VkImageMemoryBarrier2& other) {
+        return other.image == barrier.image;
+    });
+
+    if (pending == imageBarriers.end()) {
+        imageBarriers.push_back(barrier);
+        return;
+    }
+
+    // barriers in one batch are not ordered against each other, so the image goes straight to the last layout.
+    //  the second barrier's source scope is the first one's destination, which the merged barrier never leaves
+    pending->newLayout = barrier.newLayout;
+    pending->dstStageMask |= barrier.dstStageMask;
+    pending->dstAccessMask |= barrier.dstAccessMask;
+}
+
+void raymarcher::core::BarrierBatch::buffer(const Buffer& buffer, VkPipelineStageFlags2 srcStages, VkAccessFlags2 srcAccess, VkPipelineStageFlags2 dstStages, VkAccessFlags2 dstAccess) {
+    auto pending = std::find_if(bufferBarriers.begin(), bufferBarriers.end(), [&](const VkBufferMemoryBarrier2& other) {
+        return other.buffer == buffer.getHandle();
+    });
+
+    if (pending != bufferBarriers.end()) {
+        pending->srcStageMask |= srcStages;
+        pending->srcAccessMask |= srcAccess;
+        pending->dstStageMask |= dstStages;
+        pending->dstAccessMask |= dstAccess;
+        return;
+    }
+
+    bufferBarriers.push_back(VkBufferMemoryBarrier2{
+            .sType = VK_STRUCTURE_TYPE_BUFFER_MEMORY_BARRIER_2,
+            .srcStageMask = srcStages,
+            .srcAccessMask = srcAccess,
+            .dstStageMask = dstStages,
+            .dstAccessMask = dstAccess,
+            .srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED,
+            .dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED,
+            .buffer = buffer.getHandle(),
+            .offset = 0,
+            .size = VK_WHOLE_SIZE
+    });
+}
+
+void raymarcher::core::BarrierBatch::memory(VkPipelineStageFlags2 srcStages, VkAccessFlags2 srcAccess, VkPipelineStageFlags2 dstStages, VkAccessFlags2 dstAccess) {
+    if (!memoryBarrier.has_value()) {
+        memoryBarrier = VkMemoryBarrier2{
+                .sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER_2
+        };
+    }
+
+    memoryBarrier->srcStageMask |= srcStages;
+    memoryBarrier->srcAccessMask |= srcAccess;
+    memoryBarrier->dstStageMask |= dstStages;
+    memoryBarrier->dstAccessMask |= dstAccess;
+}
+
+void raymarcher::core::BarrierBatch::flush(VkCommandBuffer cmdBuffer) {
+    if (empty()) {
+        return;
+    }
+
+    VkDependencyInfo dependencyInfo{
+            .sType = VK_STRUCTURE_TYPE_DEPENDENCY_INFO,
+            .memoryBarrierCount = memoryBarrier.has_value() ? 1u : 0u,
+            .pMemoryBarriers = memoryBarrier.has_value() ? &memoryBarrier.value() : nullptr,
+            .bufferMemoryBarrierCount = static_cast<uint32_t>(bufferBarriers.size()),
+            .pBufferMemoryBarriers = bufferBarriers.data(),
+            .imageMemoryBarrierCount = static_cast<uint32_t>(imageBarriers.size()),
+            .pImageMemoryBarriers = imageBarriers.data()
+    };
+
+    vkCmdPipelineBarrier2(cmdBuffer, &dependencyInfo);
+
+    imageBarriers.clear();
+    bufferBarriers.clear();
+    memoryBarrier.reset();
+}
+
+bool raymarcher::core::BarrierBatch::empty() const {
+    return imageBarriers.empty() && bufferBarriers.empty() && !memoryBarrier.has_value();
+}
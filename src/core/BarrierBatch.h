@@ -0,0 +1,50 @@
+#ifndef RAYMARCH_BARRIERBATCH_H
+#define RAYMARCH_BARRIERBATCH_H
+
+#include <vulkan/vulkan.h>
+
+#include <vector>
+#include <optional>
+
+#include "Buffer.h"
+#include "../graphics/Image.h"
+
+namespace raymarcher::core {
+    /**
+     * Collects the barriers needed before the next command and records them with a single vkCmdPipelineBarrier2 on
+     * flush(). Tracked images decide for themselves whether a barrier is needed, so reads of an image whose last write
+     * is already visible cost nothing. Several requests for the same image or buffer are merged into one barrier.
+     */
+    class BarrierBatch {
+    public:
+        BarrierBatch() = default;
+
+        /**
+         * Move a tracked image to newLayout before it is accessed with accessMask in stages. Dropped if the image
+         * is already usable that way.
+         */
+        void image(raymarcher::graphics::Image& image, VkImageLayout newLayout, VkAccessFlags2 accessMask, VkPipelineStageFlags2 stages);
+
+        // an image barrier for an image that is not tracked, e.g. while it is being uploaded
+        void image(const VkImageMemoryBarrier2& barrier);
+
+        void buffer(const Buffer& buffer, VkPipelineStageFlags2 srcStages, VkAccessFlags2 srcAccess, VkPipelineStageFlags2 dstStages, VkAccessFlags2 dstAccess);
+
+        // global memory dependencies are all merged into one barrier
+        void memory(VkPipelineStageFlags2 srcStages, VkAccessFlags2 srcAccess, VkPipelineStageFlags2 dstStages, VkAccessFlags2 dstAccess);
+
+        /**
+         * Record every collected barrier and start a new batch. Records nothing when the batch is empty.
+         */
+        void flush(VkCommandBuffer cmdBuffer);
+
+        [[nodiscard]] bool empty() const;
+
+    private:
+        std::vector<VkImageMemoryBarrier2> imageBarriers;
+        std::vector<VkBufferMemoryBarrier2> bufferBarriers;
+        std::optional<VkMemoryBarrier2> memoryBarrier;
+    };
+}
+
+#endif //RAYMARCH_BARRIERBATCH_H
@@ -0,0 +1,57 @@
+#include "BindlessTable.h"
+
+#include <stdexcept>
+#include <string>
+
+#include "../../polyglot/bindless.h"
+
+raymarcher::core::BindlessTable::BindlessTable(VkDevice logicalDevice, DescriptorAllocator& allocator) {
+    descriptorSet = DescriptorSet{
+            logicalDevice, allocator,
+            {
+                    Binding{BINDLESS_STORAGE_IMAGE_BINDING, VK_DESCRIPTOR_TYPE_STORAGE_IMAGE, BINDLESS_MAX_STORAGE_IMAGES, VK_SHADER_STAGE_COMPUTE_BIT, true, true},
+                    Binding{BINDLESS_SAMPLED_IMAGE_BINDING, VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, BINDLESS_MAX_SAMPLED_IMAGES, VK_SHADER_STAGE_COMPUTE_BIT, true, true},
+                    Binding{BINDLESS_STORAGE_BUFFER_BINDING, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, BINDLESS_MAX_STORAGE_BUFFERS, VK_SHADER_STAGE_COMPUTE_BIT, true, true}
+            }
+    };
+}
+
+uint32_t raymarcher::core::BindlessTable::add(VkDevice logicalDevice, uint32_t bindingPoint, uint32_t& count, uint32_t capacity, const DescriptorInfo& info) {
+    if (count >= capacity) {
+        throw std::runtime_error("Bindless table binding " + std::to_string(bindingPoint) + " is full (" + std::to_string(capacity) + " entries)");
+    }
+
+    // update after bind with unused while pending, so slots can be filled even while earlier frames are in flight
+    descriptorSet.writeArrayElement(logicalDevice, static_cast<int>(bindingPoint), count, info);
+    return count++;
+}
+
+uint32_t raymarcher::core::BindlessTable::addStorageImage(VkDevice logicalDevice, const raymarcher::graphics::Image& image) {
+    return add(logicalDevice, BINDLESS_STORAGE_IMAGE_BINDING, storageImageCount, BINDLESS_MAX_STORAGE_IMAGES,
+               DescriptorInfo::of(image, VK_IMAGE_LAYOUT_GENERAL, VK_NULL_HANDLE));
+}
+
+uint32_t raymarcher::core::BindlessTable::addSampledImage(VkDevice logicalDevice, const raymarcher::graphics::Image& image, VkImageLayout imageLayout, VkSampler sampler) {
+    return add(logicalDevice, BINDLESS_SAMPLED_IMAGE_BINDING, sampledImageCount, BINDLESS_MAX_SAMPLED_IMAGES,
+               DescriptorInfo::of(image, imageLayout, sampler));
+}
+
+uint32_t raymarcher::core::BindlessTable::addStorageBuffer(VkDevice logicalDevice, const raymarcher::core::Buffer& buffer) {
+    return add(logicalDevice, BINDLESS_STORAGE_BUFFER_BINDING, storageBufferCount, BINDLESS_MAX_STORAGE_BUFFERS,
+               DescriptorInfo::of(buffer));
+}
+
+void raymarcher::core::BindlessTable::bind(VkCommandBuffer cmdBuffer, VkPipelineBindPoint bindPoint, VkPipelineLayout pipelineLayout) {
+    descriptorSet.bind(cmdBuffer, bindPoint, pipelineLayout);
+}
+
+VkDescriptorSetLayout raymarcher::core::BindlessTable::getLayout() const {
+    return descriptorSet.getLayout();
+}
+
+void raymarcher::core::BindlessTable::destroy(VkDevice logicalDevice) {
+    descriptorSet.destroy(logicalDevice);
+    storageImageCount = 0;
+    sampledImageCount = 0;
+    storageBufferCount = 0;
+}
@@ -0,0 +1,46 @@
+#ifndef RAYMARCH_BINDLESSTABLE_H
+#define RAYMARCH_BINDLESSTABLE_H
+
+#include <vulkan/vulkan.h>
+
+#include <cstdint>
+
+#include "DescriptorSet.h"
+#include "DescriptorAllocator.h"
+#include "Buffer.h"
+#include "../graphics/Image.h"
+
+namespace raymarcher::core {
+    /**
+     * One global descriptor set with a partially bound, update after bind array each of storage images, sampled images
+     * and storage buffers, laid out as in polyglot/bindless.h. Resources are added once and addressed by the returned
+     * index, which shaders get through push constants. Every pass shares the table's layout, so adding a pass needs
+     * neither a new layout nor new sets, and the table is bound once per command buffer.
+     */
+    class BindlessTable {
+    public:
+        BindlessTable() = default;
+        BindlessTable(VkDevice logicalDevice, DescriptorAllocator& allocator);
+
+        // the image must be in VK_IMAGE_LAYOUT_GENERAL whenever a shader accesses it
+        [[nodiscard]] uint32_t addStorageImage(VkDevice logicalDevice, const raymarcher::graphics::Image& image);
+        [[nodiscard]] uint32_t addSampledImage(VkDevice logicalDevice, const raymarcher::graphics::Image& image, VkImageLayout imageLayout, VkSampler sampler);
+        [[nodiscard]] uint32_t addStorageBuffer(VkDevice logicalDevice, const raymarcher::core::Buffer& buffer);
+
+        void bind(VkCommandBuffer cmdBuffer, VkPipelineBindPoint bindPoint, VkPipelineLayout pipelineLayout);
+
+        [[nodiscard]] VkDescriptorSetLayout getLayout() const;
+
+        void destroy(VkDevice logicalDevice);
+
+    private:
+        [[nodiscard]] uint32_t add(VkDevice logicalDevice, uint32_t bindingPoint, uint32_t& count, uint32_t capacity, const DescriptorInfo& info);
+
+        DescriptorSet descriptorSet;
+        uint32_t storageImageCount = 0;
+        uint32_t sampledImageCount = 0;
+        uint32_t storageBufferCount = 0;
+    };
+}
+
+#endif //RAYMARCH_BINDLESSTABLE_H
@@ -2,9 +2,10 @@
 #include "Buffer.h"
 
 #include "../tools/vktools.h"
+#include "StagingRing.h"
 
-raymarcher::core::Buffer::Buffer(VkDevice logicalDevice, VkPhysicalDevice physicalDevice, VkDeviceSize dataSize, VkBufferUsageFlags usage,
-                                 VkMemoryAllocateFlags allocFlags, VkMemoryPropertyFlags memFlags): size(dataSize) {
+raymarcher::core::Buffer::Buffer(VkDevice logicalDevice, MemoryAllocator& allocator, VkDeviceSize dataSize, VkBufferUsageFlags usage,
+                                 VkMemoryAllocateFlags allocFlags, VkMemoryPropertyFlags memFlags): allocator(&allocator), size(dataSize) {
 
     VkBufferCreateInfo createInfo{
             .sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO,
@@ -20,23 +21,17 @@ raymarcher::core::Buffer::Buffer(VkDevice logicalDevice, VkPhysicalDevice physic
     VkMemoryRequirements memRequirements;
     vkGetBufferMemoryRequirements(logicalDevice, buffer, &memRequirements);
 
-    VkMemoryAllocateFlagsInfo allocFlagsInfo{
-            .sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_FLAGS_INFO,
-            .flags = allocFlags
-    };
-
-    VkMemoryAllocateInfo allocInfo{
-            .sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO,
-            .pNext = &allocFlagsInfo,
-            .allocationSize = memRequirements.size,
-            .memoryTypeIndex = vktools::findMemoryType(physicalDevice, memRequirements.memoryTypeBits, memFlags)
-    };
+    allocation = allocator.allocate(logicalDevice, memRequirements, memFlags, allocFlags, true);
 
-    if (vkAllocateMemory(logicalDevice, &allocInfo, nullptr, &deviceMemory) != VK_SUCCESS) {
-        throw std::runtime_error("Failed to allocate buffer memory");
+    if (vkBindBufferMemory(logicalDevice, buffer, allocation.memory, allocation.offset) != VK_SUCCESS) {
+        throw std::runtime_error("Failed to bind buffer memory");
     }
+}
 
-    vkBindBufferMemory(logicalDevice, buffer, deviceMemory, 0);
+raymarcher::core::Buffer::Buffer(VkDevice logicalDevice, MemoryAllocator& allocator, StagingRing& stagingRing, const void* data, VkDeviceSize dataSize,
+                                 VkBufferUsageFlags usage, VkMemoryAllocateFlags allocFlags)
+        : Buffer(logicalDevice, allocator, dataSize, usage | VK_BUFFER_USAGE_TRANSFER_DST_BIT, allocFlags, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT) {
+    stagingRing.uploadToBuffer(*this, data, dataSize);
 }
 
 VkBuffer raymarcher::core::Buffer::getHandle() const {
@@ -44,7 +39,15 @@ VkBuffer raymarcher::core::Buffer::getHandle() const {
 }
 
 VkDeviceMemory raymarcher::core::Buffer::getDeviceMemory() const {
-    return deviceMemory;
+    return allocation.memory;
+}
+
+VkDeviceSize raymarcher::core::Buffer::getMemoryOffset() const {
+    return allocation.offset;
+}
+
+void* raymarcher::core::Buffer::getMappedData() const {
+    return allocation.mapped;
 }
 
 VkDeviceAddress raymarcher::core::Buffer::getDeviceAddress(VkDevice logicalDevice) const {
@@ -58,7 +61,13 @@ VkDeviceAddress raymarcher::core::Buffer::getDeviceAddress(VkDevice logicalDevic
 
 void raymarcher::core::Buffer::destroy(VkDevice logicalDevice) {
     vkDestroyBuffer(logicalDevice, buffer, nullptr);
-    vkFreeMemory(logicalDevice, deviceMemory, nullptr);
+
+    if (allocator != nullptr) {
+        allocator->free(logicalDevice, allocation);
+    }
+
+    buffer = VK_NULL_HANDLE;
+    allocation = {};
 }
 
 void raymarcher::core::Buffer::copyFrom(const raymarcher::core::CmdBuffer& cmdBuffer, const raymarcher::core::Buffer& src) {
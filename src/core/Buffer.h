@@ -3,57 +3,59 @@
 
 #include <vulkan/vulkan.h>
 #include <vector>
+#include <cstring>
+#include <stdexcept>
 
 #include "CmdBuffer.h"
+#include "MemoryAllocator.h"
 
 namespace raymarcher::core {
+    class StagingRing;
+
     class Buffer {
     public:
         Buffer() = default;
-        Buffer(VkDevice logicalDevice, VkPhysicalDevice physicalDevice, VkDeviceSize dataSize, VkBufferUsageFlags usage, VkMemoryAllocateFlags allocFlags, VkMemoryPropertyFlags memFlags);
+        Buffer(VkDevice logicalDevice, MemoryAllocator& allocator, VkDeviceSize dataSize, VkBufferUsageFlags usage, VkMemoryAllocateFlags allocFlags, VkMemoryPropertyFlags memFlags);
 
         template<typename T>
-        Buffer(VkDevice logicalDevice, VkPhysicalDevice physicalDevice, const std::vector<T>& data, VkBufferUsageFlags usage, VkMemoryAllocateFlags allocFlags, VkMemoryPropertyFlags memFlags)
-                : Buffer(logicalDevice, physicalDevice, data.empty() ? 0 : sizeof(data[0]) * data.size(), usage, allocFlags, memFlags)
+        Buffer(VkDevice logicalDevice, MemoryAllocator& allocator, const std::vector<T>& data, VkBufferUsageFlags usage, VkMemoryAllocateFlags allocFlags, VkMemoryPropertyFlags memFlags)
+                : Buffer(logicalDevice, allocator, data.empty() ? 0 : sizeof(data[0]) * data.size(), usage, allocFlags, memFlags)
         {
-            void* bufferData;
-            vkMapMemory(logicalDevice, deviceMemory, 0, data.size(), 0, &bufferData);
-            memcpy(bufferData, data.data(), data.size() * sizeof(T));
-            vkUnmapMemory(logicalDevice, deviceMemory);
-        }
-
-        template<typename T>
-        Buffer(VkDevice logicalDevice, VkPhysicalDevice physicalDevice, VkCommandPool cmdPool, VkQueue queue, const std::vector<T>& data, VkBufferUsageFlags usage, VkMemoryAllocateFlags allocFlags)
-                : Buffer(logicalDevice, physicalDevice, data.empty() ? 0 : sizeof(data[0]) * data.size(), usage | VK_BUFFER_USAGE_TRANSFER_DST_BIT, allocFlags, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT){
-            VkBufferUsageFlags usageFlagsStaging = VK_BUFFER_USAGE_TRANSFER_SRC_BIT;
-            VkMemoryPropertyFlags memFlagsStaging = VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT;
+            if (allocation.mapped == nullptr) {
+                throw std::runtime_error("Cannot fill a buffer that is not host visible");
+            }
 
-            Buffer stagingBuffer{logicalDevice, physicalDevice, data, usageFlagsStaging, allocFlags, memFlagsStaging};
+            memcpy(allocation.mapped, data.data(), data.size() * sizeof(T));
+        }
 
-            raymarcher::core::CmdBuffer oneTime{logicalDevice, cmdPool, true};
-            copyFrom(oneTime, stagingBuffer);
-            oneTime.endWaitSubmit(logicalDevice, queue);
-            oneTime.destroy(logicalDevice);
+        /**
+         * Create a device local buffer and queue its contents on the staging ring. The data is on the device once the
+         * ring has been flushed into a command buffer and that command buffer has executed.
+         */
+        Buffer(VkDevice logicalDevice, MemoryAllocator& allocator, StagingRing& stagingRing, const void* data, VkDeviceSize dataSize, VkBufferUsageFlags usage, VkMemoryAllocateFlags allocFlags);
 
-            stagingBuffer.destroy(logicalDevice);
-        }
+        template<typename T>
+        Buffer(VkDevice logicalDevice, MemoryAllocator& allocator, StagingRing& stagingRing, const std::vector<T>& data, VkBufferUsageFlags usage, VkMemoryAllocateFlags allocFlags)
+                : Buffer(logicalDevice, allocator, stagingRing, data.data(), data.empty() ? 0 : sizeof(data[0]) * data.size(), usage, allocFlags) {}
 
         void copyFrom(const raymarcher::core::CmdBuffer& cmdBuffer, const Buffer& src);
 
         template<typename T>
-        std::vector<T> copyToHost(VkDevice logicalDevice) {
-            void* data;
-            vkMapMemory(logicalDevice, getDeviceMemory(), 0, size, 0, &data);
+        std::vector<T> copyToHost() const {
+            if (allocation.mapped == nullptr) {
+                throw std::runtime_error("Cannot read back a buffer that is not host visible");
+            }
 
             std::vector<T> result(size / sizeof(T));
-            memcpy(result.data(), data, static_cast<size_t>(size));
+            memcpy(result.data(), allocation.mapped, result.size() * sizeof(T));
 
-            vkUnmapMemory(logicalDevice, getDeviceMemory());
             return result;
         }
 
         [[nodiscard]] VkBuffer getHandle() const;
         [[nodiscard]] VkDeviceMemory getDeviceMemory() const;
+        [[nodiscard]] VkDeviceSize getMemoryOffset() const;
+        [[nodiscard]] void* getMappedData() const;  // null unless the buffer is host visible
         [[nodiscard]] VkDeviceAddress getDeviceAddress(VkDevice logicalDevice) const;
         [[nodiscard]] VkDeviceSize getSize() const;
 
@@ -61,7 +63,8 @@ namespace raymarcher::core {
 
     private:
         VkBuffer buffer = VK_NULL_HANDLE;
-        VkDeviceMemory deviceMemory = VK_NULL_HANDLE;
+        MemoryAllocator* allocator = nullptr;
+        Allocation allocation;
         VkDeviceSize size = 0;
     };
 }
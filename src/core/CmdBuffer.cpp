@@ -74,6 +74,10 @@ void raymarcher::core::CmdBuffer::endWaitSubmit(VkDevice logicalDevice, VkQueue
 }
 
 void raymarcher::core::CmdBuffer::destroy(VkDevice logicalDevice) {
+    if (cmdBuffer == VK_NULL_HANDLE) {
+        return;  // never created, e.g. the graphics command buffers of a headless run
+    }
+
     vkFreeCommandBuffers(logicalDevice, createdCmdPool, 1, &cmdBuffer);
     vkDestroyFence(logicalDevice, fence, nullptr);
 }
@@ -0,0 +1,197 @@
+#include "DescriptorAllocator.h"
+
+#include <stdexcept>
+#include <algorithm>
+#include <sstream>
+
+raymarcher::core::DescriptorAllocator::LayoutKey raymarcher::core::DescriptorAllocator::makeKey(const std::vector<Binding>& bindings, VkDescriptorSetLayoutCreateFlags flags) {
+    LayoutKey key;
+    key.first = flags;
+    key.second.reserve(bindings.size());
+
+    for (const Binding& binding : bindings) {
+        key.second.emplace_back(binding.bindingPoint, binding.type, binding.descriptorCount, static_cast<VkShaderStageFlags>(binding.stageFlags), binding.partiallyBound, binding.updateAfterBind);
+    }
+
+    std::sort(key.second.begin(), key.second.end());
+    return key;
+}
+
+bool raymarcher::core::DescriptorAllocator::needsUpdateAfterBind(const std::vector<Binding>& bindings) {
+    return std::any_of(bindings.begin(), bindings.end(), [](const Binding& binding) {
+        return binding.updateAfterBind;
+    });
+}
+
+VkDescriptorSetLayout raymarcher::core::DescriptorAllocator::getLayout(VkDevice logicalDevice, const std::vector<Binding>& bindings, VkDescriptorSetLayoutCreateFlags flags) {
+    if (needsUpdateAfterBind(bindings)) {
+        flags |= VK_DESCRIPTOR_SET_LAYOUT_CREATE_UPDATE_AFTER_BIND_POOL_BIT;
+    }
+
+    LayoutKey key = makeKey(bindings, flags);
+
+    auto cached = layouts.find(key);
+    if (cached != layouts.end()) {
+        return cached->second;
+    }
+
+    std::vector<VkDescriptorSetLayoutBinding> vkBindings(bindings.size());
+    std::vector<VkDescriptorBindingFlags> bindingFlags(bindings.size());
+
+    for (size_t i = 0; i < bindings.size(); ++i) {
+        vkBindings[i] = bindings[i].toLayoutBinding();
+
+        if (bindings[i].partiallyBound) {
+            bindingFlags[i] |= VK_DESCRIPTOR_BINDING_PARTIALLY_BOUND_BIT_EXT;
+        }
+
+        if (bindings[i].updateAfterBind) {
+            bindingFlags[i] |= VK_DESCRIPTOR_BINDING_UPDATE_AFTER_BIND_BIT | VK_DESCRIPTOR_BINDING_UPDATE_UNUSED_WHILE_PENDING_BIT;
+        }
+    }
+
+    VkDescriptorSetLayoutBindingFlagsCreateInfo bindingFlagsInfo{
+        .sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_BINDING_FLAGS_CREATE_INFO,
+        .bindingCount = static_cast<uint32_t>(vkBindings.size()),
+        .pBindingFlags = bindingFlags.data()
+    };
+
+    VkDescriptorSetLayoutCreateInfo layoutCreateInfo{
+        .sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO,
+        .pNext = &bindingFlagsInfo,
+        .flags = flags,
+        .bindingCount = static_cast<uint32_t>(vkBindings.size()),
+        .pBindings = vkBindings.data(),
+    };
+
+    VkDescriptorSetLayout layout;
+    if (vkCreateDescriptorSetLayout(logicalDevice, &layoutCreateInfo, nullptr, &layout) != VK_SUCCESS) {
+        throw std::runtime_error("Cannot create descriptor set layout");
+    }
+
+    layouts.emplace(std::move(key), layout);
+    return layout;
+}
+
+VkDescriptorPool raymarcher::core::DescriptorAllocator::createPool(VkDevice logicalDevice, const std::vector<Binding>& bindings, uint32_t setCount, bool updateAfterBind) {
+    // room for setsPerPool sets of the common descriptor types, and always enough for the request at hand
+    std::vector<VkDescriptorPoolSize> poolSizes{
+        {VK_DESCRIPTOR_TYPE_STORAGE_IMAGE, 2 * setsPerPool},
+        {VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, setsPerPool},
+        {VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, setsPerPool},
+        {VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER, setsPerPool}
+    };
+
+    for (const Binding& binding : bindings) {
+        auto poolSize = std::find_if(poolSizes.begin(), poolSizes.end(), [&](const VkDescriptorPoolSize& size) {
+            return size.type == binding.type;
+        });
+
+        if (poolSize == poolSizes.end()) {
+            poolSizes.push_back(VkDescriptorPoolSize{.type = binding.type, .descriptorCount = 0});
+            poolSize = poolSizes.end() - 1;
+        }
+
+        poolSize->descriptorCount += binding.descriptorCount * setCount;
+    }
+
+    VkDescriptorPoolCreateInfo poolCreateInfo{
+        .sType = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO,
+        .flags = updateAfterBind ? static_cast<VkDescriptorPoolCreateFlags>(VK_DESCRIPTOR_POOL_CREATE_UPDATE_AFTER_BIND_BIT) : 0,
+        .maxSets = setsPerPool + setCount,
+        .poolSizeCount = static_cast<uint32_t>(poolSizes.size()),
+        .pPoolSizes = poolSizes.data()
+    };
+
+    VkDescriptorPool pool;
+    if (vkCreateDescriptorPool(logicalDevice, &poolCreateInfo, nullptr, &pool) != VK_SUCCESS) {
+        throw std::runtime_error("Failed to create descriptor pool");
+    }
+
+    setsPerPool = std::min(setsPerPool * 2, MAX_SETS_PER_POOL);
+    return pool;
+}
+
+std::vector<VkDescriptorSet> raymarcher::core::DescriptorAllocator::allocate(VkDevice logicalDevice, const std::vector<Binding>& bindings, uint32_t setCount, VkDescriptorPool& pool) {
+    std::vector<VkDescriptorSetLayout> setLayouts(setCount, getLayout(logicalDevice, bindings));
+    std::vector<VkDescriptorSet> sets(setCount);
+
+    bool updateAfterBind = needsUpdateAfterBind(bindings);
+    std::vector<VkDescriptorPool>& poolList = updateAfterBind ? updateAfterBindPools : pools;
+
+    VkDescriptorSetAllocateInfo allocInfo{
+        .sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO,
+        .descriptorSetCount = setCount,
+        .pSetLayouts = setLayouts.data()
+    };
+
+    if (!poolList.empty()) {
+        allocInfo.descriptorPool = poolList.back();
+        VkResult result = vkAllocateDescriptorSets(logicalDevice, &allocInfo, sets.data());
+
+        if (result == VK_SUCCESS) {
+            pool = poolList.back();
+            allocatedSets += setCount;
+            return sets;
+        } else if (result != VK_ERROR_OUT_OF_POOL_MEMORY && result != VK_ERROR_FRAGMENTED_POOL) {
+            throw std::runtime_error("Failed to allocate descriptor set");
+        }
+    }
+
+    // the current pool is full. the new one is sized for this request, so the retry cannot run out as well
+    poolList.push_back(createPool(logicalDevice, bindings, setCount, updateAfterBind));
+    allocInfo.descriptorPool = poolList.back();
+
+    if (vkAllocateDescriptorSets(logicalDevice, &allocInfo, sets.data()) != VK_SUCCESS) {
+        throw std::runtime_error("Failed to allocate descriptor set");
+    }
+
+    pool = poolList.back();
+    allocatedSets += setCount;
+    return sets;
+}
+
+void raymarcher::core::DescriptorAllocator::reset(VkDevice logicalDevice) {
+    for (std::vector<VkDescriptorPool>* poolList : {&pools, &updateAfterBindPools}) {
+        for (VkDescriptorPool pool : *poolList) {
+            vkResetDescriptorPool(logicalDevice, pool, 0);
+        }
+
+        // keep only the largest pool around, it is the one allocated from next
+        for (size_t i = 0; i + 1 < poolList->size(); i++) {
+            vkDestroyDescriptorPool(logicalDevice, (*poolList)[i], nullptr);
+        }
+
+        if (!poolList->empty()) {
+            poolList->erase(poolList->begin(), poolList->end() - 1);
+        }
+    }
+
+    allocatedSets = 0;
+}
+
+std::string raymarcher::core::DescriptorAllocator::summary() const {
+    std::ostringstream oss;
+    oss << "Descriptors: " << allocatedSets << " sets from " << pools.size() + updateAfterBindPools.size() << " pools, " << layouts.size() << " layouts\n";
+
+    return oss.str();
+}
+
+void raymarcher::core::DescriptorAllocator::destroy(VkDevice logicalDevice) {
+    for (VkDescriptorPool pool : pools) {
+        vkDestroyDescriptorPool(logicalDevice, pool, nullptr);
+    }
+
+    for (VkDescriptorPool pool : updateAfterBindPools) {
+        vkDestroyDescriptorPool(logicalDevice, pool, nullptr);
+    }
+
+    for (const auto& layout : layouts) {
+        vkDestroyDescriptorSetLayout(logicalDevice, layout.second, nullptr);
+    }
+
+    pools.clear();
+    updateAfterBindPools.clear();
+    layouts.clear();
+    allocatedSets = 0;
+}
@@ -0,0 +1,67 @@
+#ifndef RAYMARCH_DESCRIPTORALLOCATOR_H
+#define RAYMARCH_DESCRIPTORALLOCATOR_H
+
+#include <vulkan/vulkan.h>
+
+#include <vector>
+#include <map>
+#include <tuple>
+#include <utility>
+#include <string>
+#include <cstdint>
+
+#include "DescriptorSet.h"
+
+namespace raymarcher::core {
+    /**
+     * Hands out descriptor sets from a list of shared pools and deduplicates set layouts. Layouts are cached by their
+     * binding signature, so passes with identical bindings share one VkDescriptorSetLayout. When the current pool runs
+     * out, a new one twice the size is created, so the number of pools only grows logarithmically with the number of
+     * sets. Sets are never freed individually, reset() recycles every pool at once. Sets with update after bind
+     * bindings come from separate pools created with VK_DESCRIPTOR_POOL_CREATE_UPDATE_AFTER_BIND_BIT.
+     */
+    class DescriptorAllocator {
+    public:
+        static constexpr uint32_t DEFAULT_SETS_PER_POOL = 32;
+        static constexpr uint32_t MAX_SETS_PER_POOL = 4096;
+
+        DescriptorAllocator() = default;
+
+        /**
+         * Get the cached layout for bindings and flags, creating it on first use. Binding order does not matter.
+         */
+        [[nodiscard]] VkDescriptorSetLayout getLayout(VkDevice logicalDevice, const std::vector<Binding>& bindings, VkDescriptorSetLayoutCreateFlags flags = 0);
+
+        /**
+         * Allocate setCount sets with the layout for bindings. All of them come from the same pool.
+         */
+        [[nodiscard]] std::vector<VkDescriptorSet> allocate(VkDevice logicalDevice, const std::vector<Binding>& bindings, uint32_t setCount, VkDescriptorPool& pool);
+
+        /**
+         * Return every set to its pool. Only call this once none of the sets are used by the GPU anymore.
+         */
+        void reset(VkDevice logicalDevice);
+
+        [[nodiscard]] std::string summary() const;
+
+        void destroy(VkDevice logicalDevice);
+
+    private:
+        // layout flags, and per binding: binding point, type, descriptor count, stages, partially bound, update after bind
+        using LayoutKey = std::pair<VkDescriptorSetLayoutCreateFlags, std::vector<std::tuple<uint32_t, VkDescriptorType, uint32_t, VkShaderStageFlags, bool, bool>>>;
+
+        [[nodiscard]] static LayoutKey makeKey(const std::vector<Binding>& bindings, VkDescriptorSetLayoutCreateFlags flags);
+        [[nodiscard]] static bool needsUpdateAfterBind(const std::vector<Binding>& bindings);
+        [[nodiscard]] VkDescriptorPool createPool(VkDevice logicalDevice, const std::vector<Binding>& bindings, uint32_t setCount, bool updateAfterBind);
+
+        std::map<LayoutKey, VkDescriptorSetLayout> layouts;
+
+        // the last pool of each list is the one allocated from
+        std::vector<VkDescriptorPool> pools;
+        std::vector<VkDescriptorPool> updateAfterBindPools;
+        uint32_t setsPerPool = DEFAULT_SETS_PER_POOL;
+        uint32_t allocatedSets = 0;
+    };
+}
+
+#endif //RAYMARCH_DESCRIPTORALLOCATOR_H
@@ -1,7 +1,10 @@
 #include "DescriptorSet.h"
 
 #include <stdexcept>
+#include <string>
+#include <utility>
 
+#include "DescriptorAllocator.h"
 #include "../tools/vktools.h"
 
 VkDescriptorSetLayoutBinding raymarcher::core::Binding::toLayoutBinding() const {
@@ -14,92 +17,220 @@ VkDescriptorSetLayoutBinding raymarcher::core::Binding::toLayoutBinding() const
     };
 }
 
-raymarcher::core::DescriptorSet::DescriptorSet(VkDevice logicalDevice, const std::vector<Binding>& bindings)
+raymarcher::core::DescriptorSet::DescriptorSet(VkDevice logicalDevice, DescriptorAllocator& allocator, const std::vector<Binding>& bindings, uint32_t setCount)
         : bindings(bindings) {
     if (hasDuplicateBindingPoints(bindings)) {
         throw std::runtime_error("Cannot initialize descriptor set: duplicate binding points found");
     }
 
-    // Create descriptor set layout
-    std::vector<VkDescriptorSetLayoutBinding> vkBindings(bindings.size());
-    std::vector<VkDescriptorBindingFlags> bindingFlags(bindings.size());
+    if (setCount == 0) {
+        throw std::runtime_error("Cannot initialize descriptor set: at least one set is required");
+    }
 
-    for (size_t i = 0; i < bindings.size(); ++i) {
-        vkBindings[i] = bindings[i].toLayoutBinding();
+    layout = allocator.getLayout(logicalDevice, bindings);
+    descriptorSets = allocator.allocate(logicalDevice, bindings, setCount, pool);
+    descriptorCount = countDescriptors(bindings);
 
-        if (bindings[i].partiallyBound) {
-            bindingFlags[i] = VK_DESCRIPTOR_BINDING_PARTIALLY_BOUND_BIT_EXT;
-        }
+    createUpdateTemplate(logicalDevice);
+}
+
+raymarcher::core::DescriptorSet::DescriptorSet(DescriptorSet&& other) noexcept {
+    *this = std::move(other);
+}
+
+raymarcher::core::DescriptorSet& raymarcher::core::DescriptorSet::operator=(DescriptorSet&& other) noexcept {
+    if (this == &other) {
+        return *this;
     }
 
-    VkDescriptorSetLayoutBindingFlagsCreateInfo bindingFlagsInfo{
-        .sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_BINDING_FLAGS_CREATE_INFO,
-        .bindingCount = static_cast<uint32_t>(vkBindings.size()),
-        .pBindingFlags = bindingFlags.data()
-    };
+    bindings = std::move(other.bindings);
+    layout = std::exchange(other.layout, VK_NULL_HANDLE);
+    pool = std::exchange(other.pool, VK_NULL_HANDLE);
+    descriptorSets = std::move(other.descriptorSets);
+    updateTemplate = std::exchange(other.updateTemplate, VK_NULL_HANDLE);
+    descriptorCount = std::exchange(other.descriptorCount, 0);
+    pushDescriptorSet = std::exchange(other.pushDescriptorSet, false);
+    cmdPushDescriptorSet = std::exchange(other.cmdPushDescriptorSet, nullptr);
+
+    other.bindings.clear();
+    other.descriptorSets.clear();
+
+    return *this;
+}
+
+raymarcher::core::DescriptorSet raymarcher::core::DescriptorSet::createPushDescriptorSet(VkDevice logicalDevice, DescriptorAllocator& allocator, const std::vector<Binding>& bindings) {
+    if (hasDuplicateBindingPoints(bindings)) {
+        throw std::runtime_error("Cannot initialize descriptor set: duplicate binding points found");
+    }
+
+    DescriptorSet descriptorSet;
+    descriptorSet.bindings = bindings;
+    descriptorSet.layout = allocator.getLayout(logicalDevice, bindings, VK_DESCRIPTOR_SET_LAYOUT_CREATE_PUSH_DESCRIPTOR_BIT_KHR);
+    descriptorSet.descriptorCount = countDescriptors(bindings);
+    descriptorSet.pushDescriptorSet = true;
+
+    vktools::loadVkFunc(logicalDevice, "vkCmdPushDescriptorSetKHR", descriptorSet.cmdPushDescriptorSet);
+
+    return descriptorSet;
+}
 
-    VkDescriptorSetLayoutCreateInfo layoutCreateInfo{
-        .sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO,
-        .pNext = &bindingFlagsInfo,
-        .bindingCount = static_cast<uint32_t>(vkBindings.size()),
-        .pBindings = vkBindings.data(),
+void raymarcher::core::DescriptorSet::createUpdateTemplate(VkDevice logicalDevice) {
+    // infos are tightly packed DescriptorInfos, one per descriptor in binding order
+    std::vector<VkDescriptorUpdateTemplateEntry> entries;
+    entries.reserve(bindings.size());
+
+    size_t offset = 0;
+    for (const Binding& binding : bindings) {
+        entries.push_back(VkDescriptorUpdateTemplateEntry{
+                .dstBinding = binding.bindingPoint,
+                .dstArrayElement = 0,
+                .descriptorCount = binding.descriptorCount,
+                .descriptorType = binding.type,
+                .offset = offset,
+                .stride = sizeof(DescriptorInfo)
+        });
+
+        offset += binding.descriptorCount * sizeof(DescriptorInfo);
+    }
+
+    VkDescriptorUpdateTemplateCreateInfo templateInfo{
+            .sType = VK_STRUCTURE_TYPE_DESCRIPTOR_UPDATE_TEMPLATE_CREATE_INFO,
+            .descriptorUpdateEntryCount = static_cast<uint32_t>(entries.size()),
+            .pDescriptorUpdateEntries = entries.data(),
+            .templateType = VK_DESCRIPTOR_UPDATE_TEMPLATE_TYPE_DESCRIPTOR_SET,
+            .descriptorSetLayout = layout
     };
 
-    if (vkCreateDescriptorSetLayout(logicalDevice, &layoutCreateInfo, nullptr, &layout) != VK_SUCCESS) {
-        throw std::runtime_error("Cannot create descriptor set layout");
+    if (vkCreateDescriptorUpdateTemplate(logicalDevice, &templateInfo, nullptr, &updateTemplate) != VK_SUCCESS) {
+        throw std::runtime_error("Failed to create descriptor update template");
     }
+}
 
-    // Create descriptor pool (account for all descriptor types in bindings)
-    std::vector<VkDescriptorPoolSize> poolSizes;
-    for (const auto& binding : bindings) {
-        bool typeExists = false;
-        for (auto& poolSize : poolSizes) {
-            if (poolSize.type == binding.type) {
-                poolSize.descriptorCount += 1;
-                typeExists = true;
-                break;
-            }
-        }
-        if (!typeExists) {
-            poolSizes.push_back(VkDescriptorPoolSize{
-                .type = binding.type,
-                .descriptorCount = 1
-            });
+void raymarcher::core::DescriptorSet::destroy(VkDevice logicalDevice) {
+    if (updateTemplate != VK_NULL_HANDLE) {
+        vkDestroyDescriptorUpdateTemplate(logicalDevice, updateTemplate, nullptr);
+        updateTemplate = VK_NULL_HANDLE;
+    }
+
+    // the layout and the pool belong to the allocator, and the sets are returned when it resets or is destroyed
+    layout = VK_NULL_HANDLE;
+    pool = VK_NULL_HANDLE;
+    descriptorSets.clear();
+}
+
+void raymarcher::core::DescriptorSet::update(VkDevice logicalDevice, const std::vector<DescriptorInfo>& infos, uint32_t setIndex) {
+    if (pushDescriptorSet) {
+        throw std::runtime_error("Push descriptor sets have no sets to update, push them instead");
+    }
+
+    checkInfoCount(infos);
+    vkUpdateDescriptorSetWithTemplate(logicalDevice, descriptorSets.at(setIndex), updateTemplate, infos.data());
+}
+
+void raymarcher::core::DescriptorSet::push(VkCommandBuffer cmdBuffer, VkPipelineBindPoint bindPoint, VkPipelineLayout pipelineLayout, const std::vector<DescriptorInfo>& infos) {
+    if (!pushDescriptorSet) {
+        throw std::runtime_error("Only push descriptor sets can be pushed");
+    }
+
+    checkInfoCount(infos);
+
+    std::vector<VkWriteDescriptorSet> writes;
+    writes.reserve(descriptorCount);
+
+    // reserved up front, the writes point into it
+    std::vector<VkWriteDescriptorSetAccelerationStructureKHR> accelerationStructureWrites;
+    accelerationStructureWrites.reserve(descriptorCount);
+
+    const DescriptorInfo* info = infos.data();
+    for (const Binding& binding : bindings) {
+        // a union array cannot be reinterpreted as an array of one of its members, so hand over one descriptor per write
+        for (uint32_t element = 0; element < binding.descriptorCount; element++, info++) {
+            writes.push_back(describeWrite(binding, element, *info, accelerationStructureWrites.emplace_back()));
         }
     }
 
-    VkDescriptorPoolCreateInfo poolCreateInfo{
-        .sType = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO,
-        .maxSets = 1, // Allocate 1 descriptor set
-        .poolSizeCount = static_cast<uint32_t>(poolSizes.size()),
-        .pPoolSizes = poolSizes.data()
-    };
+    cmdPushDescriptorSet(cmdBuffer, bindPoint, pipelineLayout, 0, static_cast<uint32_t>(writes.size()), writes.data());
+}
 
-    if (vkCreateDescriptorPool(logicalDevice, &poolCreateInfo, nullptr, &pool) != VK_SUCCESS) {
-        throw std::runtime_error("Failed to create descriptor pool");
+void raymarcher::core::DescriptorSet::writeArrayElement(VkDevice logicalDevice, int bindingPoint, uint32_t arrayElement, const DescriptorInfo& info, uint32_t setIndex) {
+    for (const Binding& binding : bindings) {
+        if (binding.bindingPoint != bindingPoint) {
+            continue;
+        }
+
+        if (arrayElement >= binding.descriptorCount) {
+            throw std::runtime_error("Array element " + std::to_string(arrayElement) + " is out of range for binding " + std::to_string(bindingPoint));
+        }
+
+        VkWriteDescriptorSetAccelerationStructureKHR accelerationStructureWrite;
+        VkWriteDescriptorSet descriptorWrite = describeWrite(binding, arrayElement, info, accelerationStructureWrite);
+        descriptorWrite.dstSet = descriptorSets.at(setIndex);
+
+        vkUpdateDescriptorSets(logicalDevice, 1, &descriptorWrite, 0, nullptr);
+        return;
     }
 
-    // Allocate descriptor set
-    VkDescriptorSetAllocateInfo allocInfo{
-        .sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO,
-        .descriptorPool = pool,
-        .descriptorSetCount = 1, // Allocate 1 descriptor set
-        .pSetLayouts = &layout   // Use the layout created earlier
+    throw std::runtime_error("Descriptor set has no binding " + std::to_string(bindingPoint));
+}
+
+VkWriteDescriptorSet raymarcher::core::DescriptorSet::describeWrite(const Binding& binding, uint32_t arrayElement, const DescriptorInfo& info,
+                                                                   VkWriteDescriptorSetAccelerationStructureKHR& accelerationStructureWrite) {
+    VkWriteDescriptorSet write{
+            .sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET,
+            .dstBinding = binding.bindingPoint,
+            .dstArrayElement = arrayElement,
+            .descriptorCount = 1,
+            .descriptorType = binding.type
     };
 
-    if (vkAllocateDescriptorSets(logicalDevice, &allocInfo, &descriptorSet) != VK_SUCCESS) {
-        throw std::runtime_error("Failed to allocate descriptor set");
+    // acceleration structures are not images or buffers, they are handed over in the pNext chain
+    if (binding.type == VK_DESCRIPTOR_TYPE_ACCELERATION_STRUCTURE_KHR) {
+        accelerationStructureWrite = VkWriteDescriptorSetAccelerationStructureKHR{
+                .sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET_ACCELERATION_STRUCTURE_KHR,
+                .accelerationStructureCount = 1,
+                .pAccelerationStructures = &info.accelerationStructure
+        };
+
+        write.pNext = &accelerationStructureWrite;
+    } else if (isBufferType(binding.type)) {
+        write.pBufferInfo = &info.buffer;
+    } else {
+        write.pImageInfo = &info.image;
     }
+
+    return write;
 }
 
-void raymarcher::core::DescriptorSet::destroy(VkDevice logicalDevice) {
-    if (layout != VK_NULL_HANDLE) {
-        vkDestroyDescriptorSetLayout(logicalDevice, layout, nullptr);
+bool raymarcher::core::DescriptorSet::isBufferType(VkDescriptorType type) {
+    return type == VK_DESCRIPTOR_TYPE_STORAGE_BUFFER || type == VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER
+        || type == VK_DESCRIPTOR_TYPE_STORAGE_BUFFER_DYNAMIC || type == VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC;
+}
+
+void raymarcher::core::DescriptorSet::checkInfoCount(const std::vector<DescriptorInfo>& infos) const {
+    if (infos.size() != descriptorCount) {
+        throw std::runtime_error("Expected " + std::to_string(descriptorCount) + " descriptor infos, got " + std::to_string(infos.size()));
     }
+}
 
-    if (pool != VK_NULL_HANDLE) {
-        vkDestroyDescriptorPool(logicalDevice, pool, nullptr);
+uint32_t raymarcher::core::DescriptorSet::countDescriptors(const std::vector<Binding>& bindings) {
+    uint32_t count = 0;
+    for (const Binding& binding : bindings) {
+        count += binding.descriptorCount;
     }
+
+    return count;
+}
+
+raymarcher::core::DescriptorInfo raymarcher::core::DescriptorInfo::of(const raymarcher::core::Buffer& buffer) {
+    DescriptorInfo info{};
+    info.buffer = VkDescriptorBufferInfo{.buffer = buffer.getHandle(), .offset = 0, .range = VK_WHOLE_SIZE};
+    return info;
+}
+
+raymarcher::core::DescriptorInfo raymarcher::core::DescriptorInfo::of(const raymarcher::graphics::Image& image, VkImageLayout imageLayout, VkSampler sampler) {
+    DescriptorInfo info{};
+    info.image = VkDescriptorImageInfo{.sampler = sampler, .imageView = image.getImageView(), .imageLayout = imageLayout};
+    return info;
 }
 
 bool raymarcher::core::DescriptorSet::hasDuplicateBindingPoints(const std::vector<Binding>& bindings) {
@@ -122,24 +253,32 @@ VkDescriptorPool raymarcher::core::DescriptorSet::getPool() const {
     return pool;
 }
 
-VkDescriptorSet raymarcher::core::DescriptorSet::getDescriptorSet() const {
-    return descriptorSet;
+VkDescriptorSet raymarcher::core::DescriptorSet::getDescriptorSet(uint32_t setIndex) const {
+    return descriptorSets.at(setIndex);
+}
+
+uint32_t raymarcher::core::DescriptorSet::getSetCount() const {
+    return static_cast<uint32_t>(descriptorSets.size());
+}
+
+bool raymarcher::core::DescriptorSet::isPushDescriptorSet() const {
+    return pushDescriptorSet;
 }
 
-void raymarcher::core::DescriptorSet::bind(VkCommandBuffer cmdBuffer, VkPipelineBindPoint bindPoint, VkPipelineLayout pipelineLayout) {
+void raymarcher::core::DescriptorSet::bind(VkCommandBuffer cmdBuffer, VkPipelineBindPoint bindPoint, VkPipelineLayout pipelineLayout, uint32_t setIndex) {
     vkCmdBindDescriptorSets(
             cmdBuffer,
             bindPoint,
             pipelineLayout,
             0,
             1,
-            &descriptorSet,
+            &descriptorSets.at(setIndex),
             0,
             nullptr
     );
 }
 
-void raymarcher::core::DescriptorSet::writeBinding(VkDevice logicalDevice, int bindingPoint, VkDescriptorImageInfo *imageInfo,
+void raymarcher::core::DescriptorSet::writeBinding(VkDevice logicalDevice, int bindingPoint, uint32_t setIndex, VkDescriptorImageInfo *imageInfo,
                                                    VkDescriptorBufferInfo *bufferInfo, void *next) {
 
     for (const Binding& binding : bindings) {
@@ -149,7 +288,7 @@ void raymarcher::core::DescriptorSet::writeBinding(VkDevice logicalDevice, int b
 
         VkWriteDescriptorSet descriptorWrite{};
         descriptorWrite.sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
-        descriptorWrite.dstSet = descriptorSet;
+        descriptorWrite.dstSet = descriptorSets.at(setIndex);
         descriptorWrite.dstBinding = binding.bindingPoint;
         descriptorWrite.dstArrayElement = 0;  // assuming we are not working with arrays of descriptors per binding
         descriptorWrite.descriptorType = binding.type;
@@ -169,29 +308,29 @@ void raymarcher::core::DescriptorSet::writeBinding(VkDevice logicalDevice, int b
     }
 }
 
-void raymarcher::core::DescriptorSet::writeBinding(VkDevice logicalDevice, int bindingPoint, const raymarcher::core::Buffer& buffer) {
+void raymarcher::core::DescriptorSet::writeBinding(VkDevice logicalDevice, int bindingPoint, const raymarcher::core::Buffer& buffer, uint32_t setIndex) {
     VkDescriptorBufferInfo bufferInfo{.buffer = buffer.getHandle(), .offset = 0, .range = VK_WHOLE_SIZE};
-    writeBinding(logicalDevice, bindingPoint, nullptr, &bufferInfo, nullptr);
+    writeBinding(logicalDevice, bindingPoint, setIndex, nullptr, &bufferInfo, nullptr);
 }
 
-void raymarcher::core::DescriptorSet::writeBinding(VkDevice logicalDevice, int bindingPoint, const raymarcher::graphics::Image& image, VkImageLayout imageLayout, VkSampler sampler) {
+void raymarcher::core::DescriptorSet::writeBinding(VkDevice logicalDevice, int bindingPoint, const raymarcher::graphics::Image& image, VkImageLayout imageLayout, VkSampler sampler, uint32_t setIndex) {
     VkDescriptorImageInfo imageInfo{.sampler = sampler, .imageView = image.getImageView(), .imageLayout = imageLayout};
-    writeBinding(logicalDevice, bindingPoint, &imageInfo, nullptr, nullptr);
+    writeBinding(logicalDevice, bindingPoint, setIndex, &imageInfo, nullptr, nullptr);
 }
 
-void raymarcher::core::DescriptorSet::writeBinding(VkDevice logicalDevice, int bindingPoint, const vktools::AccStructureInfo& accStruct) {
+void raymarcher::core::DescriptorSet::writeBinding(VkDevice logicalDevice, int bindingPoint, const vktools::AccStructureInfo& accStruct, uint32_t setIndex) {
     VkWriteDescriptorSetAccelerationStructureKHR descriptorAccStructure{
             .sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET_ACCELERATION_STRUCTURE_KHR,
             .accelerationStructureCount = 1,
             .pAccelerationStructures = &accStruct.accelerationStructure
     };
 
-    writeBinding(logicalDevice, bindingPoint, nullptr, nullptr, &descriptorAccStructure);
+    writeBinding(logicalDevice, bindingPoint, setIndex, nullptr, nullptr, &descriptorAccStructure);
 }
 
 void raymarcher::core::DescriptorSet::writeBinding(VkDevice logicalDevice, int bindingPoint,
                                                    const std::vector<raymarcher::graphics::Image>& images,
-                                                   VkImageLayout imageLayout, VkSampler sampler) {
+                                                   VkImageLayout imageLayout, VkSampler sampler, uint32_t setIndex) {
 
     // todo: merge this with the generic writeBinding to prevent some repeated code
     auto imageCount = static_cast<uint32_t>(images.size());
@@ -210,7 +349,7 @@ void raymarcher::core::DescriptorSet::writeBinding(VkDevice logicalDevice, int b
 
         VkWriteDescriptorSet descriptorWrite{
                 .sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET,
-                .dstSet = descriptorSet,
+                .dstSet = descriptorSets.at(setIndex),
                 .dstBinding = binding.bindingPoint,
                 .dstArrayElement = 0,
                 .descriptorCount = imageCount,
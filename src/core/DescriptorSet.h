@@ -13,6 +13,10 @@ namespace vktools {
     struct AccStructureInfo;
 }
 
+namespace raymarcher::core {
+    class DescriptorAllocator;
+}
+
 namespace raymarcher::core {
     struct Binding {
         uint32_t bindingPoint;
@@ -20,37 +24,102 @@ namespace raymarcher::core {
         uint32_t descriptorCount;
         VkShaderStageFlagBits stageFlags;
         bool partiallyBound = false;
+        bool updateAfterBind = false;  // may be written while bound, and while pending if unused. the set comes from an update after bind pool
 
         [[nodiscard]] VkDescriptorSetLayoutBinding toLayoutBinding() const;
     };
 
+    /**
+     * One descriptor as read by an update template or a push. Passes hand over one entry per descriptor, in the order
+     * of the bindings the DescriptorSet was created with.
+     */
+    union DescriptorInfo {
+        VkDescriptorImageInfo image;
+        VkDescriptorBufferInfo buffer;
+        VkAccelerationStructureKHR accelerationStructure;
+
+        [[nodiscard]] static DescriptorInfo of(const raymarcher::core::Buffer& buffer);
+        [[nodiscard]] static DescriptorInfo of(const raymarcher::graphics::Image& image, VkImageLayout imageLayout, VkSampler sampler);
+    };
+
+    /**
+     * One layout with setCount descriptor sets allocated from it. Every write and bind selects a set by index, so
+     * all the resource combinations a pass alternates between can be written once up front and only bound afterwards.
+     * The layout and the sets are owned by the DescriptorAllocator they came from.
+     *
+     * update() writes all bindings of a set in one call through a descriptor update template. A push descriptor set
+     * allocates no sets at all, push() records its bindings straight into the command buffer instead.
+     */
     class DescriptorSet {
     public:
         DescriptorSet() = default;
-        DescriptorSet(VkDevice logicalDevice, const std::vector<Binding>& bindings);
+        DescriptorSet(VkDevice logicalDevice, DescriptorAllocator& allocator, const std::vector<Binding>& bindings, uint32_t setCount = 1);
+
+        // the update template is owned, so a set can only be moved. a moved from set owns nothing, and a set that is
+        //  assigned to has to be destroyed first
+        DescriptorSet(const DescriptorSet&) = delete;
+        DescriptorSet& operator=(const DescriptorSet&) = delete;
+        DescriptorSet(DescriptorSet&& other) noexcept;
+        DescriptorSet& operator=(DescriptorSet&& other) noexcept;
 
-        void bind(VkCommandBuffer cmdBuffer, VkPipelineBindPoint bindPoint, VkPipelineLayout pipelineLayout);
+        /**
+         * Create a set whose bindings are pushed while recording. Requires VK_KHR_push_descriptor.
+         */
+        [[nodiscard]] static DescriptorSet createPushDescriptorSet(VkDevice logicalDevice, DescriptorAllocator& allocator, const std::vector<Binding>& bindings);
 
-        void writeBinding(VkDevice logicalDevice, int bindingPoint, const raymarcher::core::Buffer& buffer);
-        void writeBinding(VkDevice logicalDevice, int bindingPoint, const raymarcher::graphics::Image& image, VkImageLayout imageLayout, VkSampler sampler);
-        void writeBinding(VkDevice logicalDevice, int bindingPoint, const std::vector<raymarcher::graphics::Image>& images, VkImageLayout imageLayout, VkSampler sampler);
-        void writeBinding(VkDevice logicalDevice, int bindingPoint, const vktools::AccStructureInfo& accStruct);
+        void bind(VkCommandBuffer cmdBuffer, VkPipelineBindPoint bindPoint, VkPipelineLayout pipelineLayout, uint32_t setIndex = 0);
+
+        /**
+         * Write every binding of a set at once, with one entry per descriptor in binding order.
+         */
+        void update(VkDevice logicalDevice, const std::vector<DescriptorInfo>& infos, uint32_t setIndex = 0);
+
+        /**
+         * Write a single element of an array binding, e.g. one slot of a bindless table.
+         */
+        void writeArrayElement(VkDevice logicalDevice, int bindingPoint, uint32_t arrayElement, const DescriptorInfo& info, uint32_t setIndex = 0);
+
+        /**
+         * Push every binding into cmdBuffer, with one entry per descriptor in binding order. Only for push descriptor sets.
+         */
+        void push(VkCommandBuffer cmdBuffer, VkPipelineBindPoint bindPoint, VkPipelineLayout pipelineLayout, const std::vector<DescriptorInfo>& infos);
+
+        void writeBinding(VkDevice logicalDevice, int bindingPoint, const raymarcher::core::Buffer& buffer, uint32_t setIndex = 0);
+        void writeBinding(VkDevice logicalDevice, int bindingPoint, const raymarcher::graphics::Image& image, VkImageLayout imageLayout, VkSampler sampler, uint32_t setIndex = 0);
+        void writeBinding(VkDevice logicalDevice, int bindingPoint, const std::vector<raymarcher::graphics::Image>& images, VkImageLayout imageLayout, VkSampler sampler, uint32_t setIndex = 0);
+        void writeBinding(VkDevice logicalDevice, int bindingPoint, const vktools::AccStructureInfo& accStruct, uint32_t setIndex = 0);
 
         void destroy(VkDevice device);
 
         [[nodiscard]] VkDescriptorSetLayout getLayout() const;
         [[nodiscard]] VkDescriptorPool getPool() const;
-        [[nodiscard]] VkDescriptorSet getDescriptorSet() const;
+        [[nodiscard]] VkDescriptorSet getDescriptorSet(uint32_t setIndex = 0) const;
+        [[nodiscard]] uint32_t getSetCount() const;
+        [[nodiscard]] bool isPushDescriptorSet() const;
 
     private:
         std::vector<Binding> bindings{};
         VkDescriptorSetLayout layout = VK_NULL_HANDLE;
-        VkDescriptorPool pool = VK_NULL_HANDLE;
-        VkDescriptorSet descriptorSet = VK_NULL_HANDLE;
+        VkDescriptorPool pool = VK_NULL_HANDLE;  // the shared pool the sets were allocated from
+        std::vector<VkDescriptorSet> descriptorSets{};
+
+        VkDescriptorUpdateTemplate updateTemplate = VK_NULL_HANDLE;
+        uint32_t descriptorCount = 0;  // over all bindings, i.e. the number of infos update() and push() expect
+
+        bool pushDescriptorSet = false;
+        PFN_vkCmdPushDescriptorSetKHR cmdPushDescriptorSet = nullptr;  // extension function, loaded at creation
 
         [[nodiscard]] static bool hasDuplicateBindingPoints(const std::vector<Binding>& bindings);
+        [[nodiscard]] static uint32_t countDescriptors(const std::vector<Binding>& bindings);
+        [[nodiscard]] static bool isBufferType(VkDescriptorType type);
+
+        // one descriptor of binding, without a dstSet. acceleration structures are chained through accelerationStructureWrite
+        [[nodiscard]] static VkWriteDescriptorSet describeWrite(const Binding& binding, uint32_t arrayElement, const DescriptorInfo& info,
+                                                                VkWriteDescriptorSetAccelerationStructureKHR& accelerationStructureWrite);
+        void createUpdateTemplate(VkDevice logicalDevice);
+        void checkInfoCount(const std::vector<DescriptorInfo>& infos) const;
 
-        void writeBinding(VkDevice logicalDevice, int bindingPoint, VkDescriptorImageInfo *imageInfo,
+        void writeBinding(VkDevice logicalDevice, int bindingPoint, uint32_t setIndex, VkDescriptorImageInfo *imageInfo,
                           VkDescriptorBufferInfo *bufferInfo, void *next);
     };
 }
@@ -0,0 +1,205 @@
+#include "MemoryAllocator.h"
+
+#include <stdexcept>
+#include <sstream>
+#include <iterator>
+#include <algorithm>
+
+raymarcher::core::MemoryAllocator::MemoryAllocator(VkPhysicalDevice physicalDevice, VkDeviceSize blockSize)
+        : blockSize(blockSize) {
+    vkGetPhysicalDeviceMemoryProperties(physicalDevice, &memoryProperties);
+
+    // never make blocks larger than the heap they live in, which matters on small integrated and CPU devices
+    for (uint32_t i = 0; i < memoryProperties.memoryHeapCount; i++) {
+        if (memoryProperties.memoryHeaps[i].size / 8 < this->blockSize) {
+            this->blockSize = std::max<VkDeviceSize>(memoryProperties.memoryHeaps[i].size / 8, 1024 * 1024);
+        }
+    }
+}
+
+uint32_t raymarcher::core::MemoryAllocator::findMemoryType(uint32_t typeFilter, VkMemoryPropertyFlags properties) const {
+    for (uint32_t i = 0; i < memoryProperties.memoryTypeCount; i++) {
+        if ((typeFilter & (1 << i)) && (memoryProperties.memoryTypes[i].propertyFlags & properties) == properties) {
+            return i;
+        }
+    }
+
+    throw std::runtime_error("Failed to find suitable memory type");
+}
+
+raymarcher::core::MemoryAllocator::Pool& raymarcher::core::MemoryAllocator::getPool(uint32_t memoryTypeIndex, VkMemoryAllocateFlags allocFlags, bool linear, uint32_t& poolIndex) {
+    for (uint32_t i = 0; i < pools.size(); i++) {
+        if (pools[i].memoryTypeIndex == memoryTypeIndex && pools[i].allocFlags == allocFlags && pools[i].linear == linear) {
+            poolIndex = i;
+            return pools[i];
+        }
+    }
+
+    poolIndex = static_cast<uint32_t>(pools.size());
+    pools.push_back(Pool{memoryTypeIndex, allocFlags, linear, {}});
+    return pools.back();
+}
+
+VkDeviceMemory raymarcher::core::MemoryAllocator::allocateMemory(VkDevice logicalDevice, VkDeviceSize size, uint32_t memoryTypeIndex, VkMemoryAllocateFlags allocFlags, void** mapped) const {
+    VkMemoryAllocateFlagsInfo allocFlagsInfo{
+            .sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_FLAGS_INFO,
+            .flags = allocFlags
+    };
+
+    VkMemoryAllocateInfo allocInfo{
+            .sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO,
+            .pNext = &allocFlagsInfo,
+            .allocationSize = size,
+            .memoryTypeIndex = memoryTypeIndex
+    };
+
+    VkDeviceMemory memory;
+    if (vkAllocateMemory(logicalDevice, &allocInfo, nullptr, &memory) != VK_SUCCESS) {
+        throw std::runtime_error("Failed to allocate device memory");
+    }
+
+    // host visible memory is mapped once for its whole lifetime, since a VkDeviceMemory can only be mapped once at a
+    //  time and several resources share it
+    *mapped = nullptr;
+    if (memoryProperties.memoryTypes[memoryTypeIndex].propertyFlags & VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT) {
+        if (vkMapMemory(logicalDevice, memory, 0, VK_WHOLE_SIZE, 0, mapped) != VK_SUCCESS) {
+            vkFreeMemory(logicalDevice, memory, nullptr);
+            throw std::runtime_error("Failed to map device memory");
+        }
+    }
+
+    return memory;
+}
+
+bool raymarcher::core::MemoryAllocator::allocateFromBlock(Block& block, VkDeviceSize size, VkDeviceSize alignment, VkDeviceSize& offset) {
+    // first fit
+    for (auto it = block.freeRanges.begin(); it != block.freeRanges.end(); ++it) {
+        VkDeviceSize rangeStart = it->first;
+        VkDeviceSize rangeEnd = it->first + it->second;
+        VkDeviceSize alignedStart = (rangeStart + alignment - 1) / alignment * alignment;
+
+        if (alignedStart + size > rangeEnd) {
+            continue;
+        }
+
+        block.freeRanges.erase(it);
+
+        // keep whatever is left on either side of the allocation
+        if (alignedStart > rangeStart) {
+            block.freeRanges[rangeStart] = alignedStart - rangeStart;
+        }
+
+        if (alignedStart + size < rangeEnd) {
+            block.freeRanges[alignedStart + size] = rangeEnd - (alignedStart + size);
+        }
+
+        offset = alignedStart;
+        return true;
+    }
+
+    return false;
+}
+
+raymarcher::core::Allocation raymarcher::core::MemoryAllocator::allocate(VkDevice logicalDevice, const VkMemoryRequirements& requirements, VkMemoryPropertyFlags properties, VkMemoryAllocateFlags allocFlags, bool linear) {
+    uint32_t memoryTypeIndex = findMemoryType(requirements.memoryTypeBits, properties);
+    VkDeviceSize alignment = std::max<VkDeviceSize>(requirements.alignment, 1);
+
+    Allocation allocation{
+            .size = requirements.size
+    };
+
+    // large resources would waste most of a block, so they get their own memory
+    if (requirements.size > blockSize / 2) {
+        allocation.memory = allocateMemory(logicalDevice, requirements.size, memoryTypeIndex, allocFlags, &allocation.mapped);
+        allocation.dedicated = true;
+        dedicatedCount++;
+        return allocation;
+    }
+
+    Pool& pool = getPool(memoryTypeIndex, allocFlags, linear, allocation.poolIndex);
+
+    for (uint32_t i = 0; i < pool.blocks.size(); i++) {
+        if (allocateFromBlock(pool.blocks[i], requirements.size, alignment, allocation.offset)) {
+            allocation.blockIndex = i;
+            allocation.memory = pool.blocks[i].memory;
+            allocation.mapped = pool.blocks[i].mapped ? static_cast<char*>(pool.blocks[i].mapped) + allocation.offset : nullptr;
+            return allocation;
+        }
+    }
+
+    Block block{.size = blockSize};
+    block.memory = allocateMemory(logicalDevice, blockSize, memoryTypeIndex, allocFlags, &block.mapped);
+    block.freeRanges[0] = blockSize;
+
+    allocateFromBlock(block, requirements.size, alignment, allocation.offset);
+    allocation.blockIndex = static_cast<uint32_t>(pool.blocks.size());
+    allocation.memory = block.memory;
+    allocation.mapped = block.mapped ? static_cast<char*>(block.mapped) + allocation.offset : nullptr;
+
+    pool.blocks.push_back(block);
+    return allocation;
+}
+
+void raymarcher::core::MemoryAllocator::free(VkDevice logicalDevice, const Allocation& allocation) {
+    if (allocation.memory == VK_NULL_HANDLE) {
+        return;
+    }
+
+    if (allocation.dedicated) {
+        vkFreeMemory(logicalDevice, allocation.memory, nullptr);  // also unmaps
+        dedicatedCount--;
+        return;
+    }
+
+    Block& block = pools[allocation.poolIndex].blocks[allocation.blockIndex];
+    auto inserted = block.freeRanges.emplace(allocation.offset, allocation.size).first;
+
+    // merge with the following range
+    auto next = std::next(inserted);
+    if (next != block.freeRanges.end() && inserted->first + inserted->second == next->first) {
+        inserted->second += next->second;
+        block.freeRanges.erase(next);
+    }
+
+    // merge with the preceding range
+    if (inserted != block.freeRanges.begin()) {
+        auto previous = std::prev(inserted);
+        if (previous->first + previous->second == inserted->first) {
+            previous->second += inserted->second;
+            block.freeRanges.erase(inserted);
+        }
+    }
+
+    // blocks are kept when they become empty, so the next resource of the same kind does not allocate again
+}
+
+std::string raymarcher::core::MemoryAllocator::summary() const {
+    std::ostringstream oss;
+
+    size_t blockCount = 0;
+    VkDeviceSize freeBytes = 0;
+    for (const Pool& pool : pools) {
+        blockCount += pool.blocks.size();
+
+        for (const Block& block : pool.blocks) {
+            for (const auto& range : block.freeRanges) {
+                freeBytes += range.second;
+            }
+        }
+    }
+
+    oss << "Device memory: " << blockCount << " blocks of " << blockSize / (1024 * 1024) << "MiB ("
+        << freeBytes / (1024 * 1024) << "MiB free), " << dedicatedCount << " dedicated allocations\n";
+
+    return oss.str();
+}
+
+void raymarcher::core::MemoryAllocator::destroy(VkDevice logicalDevice) {
+    for (Pool& pool : pools) {
+        for (Block& block : pool.blocks) {
+            vkFreeMemory(logicalDevice, block.memory, nullptr);
+        }
+    }
+
+    pools.clear();
+}
@@ -0,0 +1,78 @@
+#ifndef RAYMARCH_MEMORYALLOCATOR_H
+#define RAYMARCH_MEMORYALLOCATOR_H
+
+#include <vulkan/vulkan.h>
+
+#include <vector>
+#include <map>
+#include <memory>
+#include <string>
+#include <cstdint>
+
+namespace raymarcher::core {
+    /**
+     * A range of device memory handed out by MemoryAllocator. Bind resources at memory + offset.
+     */
+    struct Allocation {
+        VkDeviceMemory memory = VK_NULL_HANDLE;
+        VkDeviceSize offset = 0;
+        VkDeviceSize size = 0;
+        void* mapped = nullptr;  // points at offset. only set for host visible memory, which stays mapped
+
+        uint32_t poolIndex = 0;
+        uint32_t blockIndex = 0;
+        bool dedicated = false;
+    };
+
+    /**
+     * Sub-allocates buffers and images from large blocks instead of making one vkAllocateMemory call per resource.
+     * Blocks are pooled per memory type, allocate flags and resource kind. Linear (buffer) and optimal (image)
+     * resources never share a block, so bufferImageGranularity cannot be violated. Within a block, free ranges are
+     * kept sorted by offset and merged on free. Requests larger than half a block get their own allocation.
+     */
+    class MemoryAllocator {
+    public:
+        static constexpr VkDeviceSize DEFAULT_BLOCK_SIZE = 64ull * 1024 * 1024;
+
+        MemoryAllocator() = default;
+        explicit MemoryAllocator(VkPhysicalDevice physicalDevice, VkDeviceSize blockSize = DEFAULT_BLOCK_SIZE);
+
+        /**
+         * @param linear True for buffers and linear images, false for optimally tiled images.
+         */
+        [[nodiscard]] Allocation allocate(VkDevice logicalDevice, const VkMemoryRequirements& requirements, VkMemoryPropertyFlags properties, VkMemoryAllocateFlags allocFlags, bool linear);
+        void free(VkDevice logicalDevice, const Allocation& allocation);
+
+        [[nodiscard]] std::string summary() const;
+
+        void destroy(VkDevice logicalDevice);
+
+    private:
+        struct Block {
+            VkDeviceMemory memory = VK_NULL_HANDLE;
+            VkDeviceSize size = 0;
+            void* mapped = nullptr;
+            std::map<VkDeviceSize, VkDeviceSize> freeRanges;  // offset -> size
+        };
+
+        struct Pool {
+            uint32_t memoryTypeIndex;
+            VkMemoryAllocateFlags allocFlags;
+            bool linear;
+            std::vector<Block> blocks;
+        };
+
+        [[nodiscard]] uint32_t findMemoryType(uint32_t typeFilter, VkMemoryPropertyFlags properties) const;
+        [[nodiscard]] Pool& getPool(uint32_t memoryTypeIndex, VkMemoryAllocateFlags allocFlags, bool linear, uint32_t& poolIndex);
+
+        VkDeviceMemory allocateMemory(VkDevice logicalDevice, VkDeviceSize size, uint32_t memoryTypeIndex, VkMemoryAllocateFlags allocFlags, void** mapped) const;
+        static bool allocateFromBlock(Block& block, VkDeviceSize size, VkDeviceSize alignment, VkDeviceSize& offset);
+
+        VkPhysicalDeviceMemoryProperties memoryProperties{};
+        VkDeviceSize blockSize = DEFAULT_BLOCK_SIZE;
+        std::vector<Pool> pools;
+        uint32_t dedicatedCount = 0;
+    };
+}
+
+#endif //RAYMARCH_MEMORYALLOCATOR_H
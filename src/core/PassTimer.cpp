@@ -0,0 +1,111 @@
+#include "PassTimer.h"
+
+#include <sstream>
+#include <stdexcept>
+
+raymarcher::core::PassTimer::PassTimer(VkDevice logicalDevice, uint32_t frameSlots, uint32_t maxPasses, float timestampPeriod)
+        : maxPasses(maxPasses), timestampPeriod(timestampPeriod), slotPasses(frameSlots) {
+    VkQueryPoolCreateInfo createInfo{
+            .sType = VK_STRUCTURE_TYPE_QUERY_POOL_CREATE_INFO,
+            .queryType = VK_QUERY_TYPE_TIMESTAMP,
+            .queryCount = 2 * maxPasses * frameSlots
+    };
+
+    if (vkCreateQueryPool(logicalDevice, &createInfo, nullptr, &queryPool) != VK_SUCCESS) {
+        throw std::runtime_error("Failed to create timestamp query pool");
+    }
+}
+
+void raymarcher::core::PassTimer::begin(VkCommandBuffer cmdBuffer, uint32_t frameSlot) {
+    recordingSlot = frameSlot;
+    slotPasses[frameSlot].clear();
+    passOpen = false;
+
+    vkCmdResetQueryPool(cmdBuffer, queryPool, 2 * maxPasses * frameSlot, 2 * maxPasses);
+}
+
+void raymarcher::core::PassTimer::beginPass(VkCommandBuffer cmdBuffer, const std::string& name) {
+    std::vector<std::string>& passes = slotPasses[recordingSlot];
+    if (passes.size() >= maxPasses) {
+        return;
+    }
+
+    // ALL_COMMANDS waits for everything before it, so the pass is measured from the end of the one before
+    const auto query = static_cast<uint32_t>(2 * (maxPasses * recordingSlot + passes.size()));
+    vkCmdWriteTimestamp2(cmdBuffer, VK_PIPELINE_STAGE_2_ALL_COMMANDS_BIT, queryPool, query);
+
+    passes.push_back(name);
+    passOpen = true;
+}
+
+void raymarcher::core::PassTimer::endPass(VkCommandBuffer cmdBuffer) {
+    if (!passOpen) {
+        return;
+    }
+
+    const std::vector<std::string>& passes = slotPasses[recordingSlot];
+    const auto query = static_cast<uint32_t>(2 * (maxPasses * recordingSlot + passes.size() - 1) + 1);
+    vkCmdWriteTimestamp2(cmdBuffer, VK_PIPELINE_STAGE_2_ALL_COMMANDS_BIT, queryPool, query);
+
+    passOpen = false;
+}
+
+void raymarcher::core::PassTimer::complete(VkDevice logicalDevice, uint32_t frameSlot) {
+    if (!isEnabled()) {
+        return;
+    }
+
+    std::vector<std::string>& passes = slotPasses[frameSlot];
+    if (passes.empty()) {
+        return;
+    }
+
+    std::vector<uint64_t> timestamps(2 * passes.size());
+    VkResult result = vkGetQueryPoolResults(logicalDevice, queryPool, 2 * maxPasses * frameSlot, static_cast<uint32_t>(timestamps.size()),
+                                            timestamps.size() * sizeof(uint64_t), timestamps.data(), sizeof(uint64_t),
+                                            VK_QUERY_RESULT_64_BIT | VK_QUERY_RESULT_WAIT_BIT);
+
+    if (result != VK_SUCCESS) {
+        throw std::runtime_error("Failed to read pass timestamps");
+    }
+
+    // passes recorded more than once a frame, like the box blur passes, count as one
+    std::map<std::string, double> frameTimes;
+    for (size_t i = 0; i < passes.size(); i++) {
+        frameTimes[passes[i]] += static_cast<double>(timestamps[2 * i + 1] - timestamps[2 * i]) * timestampPeriod * 1e-9;
+    }
+
+    for (const auto& [name, seconds] : frameTimes) {
+        passTimes[name].addEntry(seconds);
+    }
+
+    passes.clear();
+}
+
+void raymarcher::core::PassTimer::reset() {
+    passTimes.clear();
+}
+
+bool raymarcher::core::PassTimer::isEnabled() const {
+    return queryPool != VK_NULL_HANDLE;
+}
+
+const std::map<std::string, raymarcher::tools::TimeEntries>& raymarcher::core::PassTimer::getPassTimes() const {
+    return passTimes;
+}
+
+std::string raymarcher::core::PassTimer::summary() const {
+    std::ostringstream oss;
+
+    for (const auto& [name, time] : passTimes) {
+        oss << "Average GPU pass time | " << name << ": " << time.averageTime * 1000 << "ms over " << time.recordings << " frames\n";
+    }
+
+    return oss.str();
+}
+
+void raymarcher::core::PassTimer::destroy(VkDevice logicalDevice) {
+    vkDestroyQueryPool(logicalDevice, queryPool, nullptr);
+    queryPool = VK_NULL_HANDLE;
+    slotPasses.clear();
+}
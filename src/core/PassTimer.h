@@ -0,0 +1,65 @@
+#ifndef RAYMARCH_PASSTIMER_H
+#define RAYMARCH_PASSTIMER_H
+
+#include <vulkan/vulkan.h>
+
+#include <map>
+#include <string>
+#include <vector>
+#include <cstdint>
+
+#include "../tools/Clock.h"
+
+namespace raymarcher::core {
+    /**
+     * Measures how long each render graph pass takes on the GPU, with a timestamp before and after it. Every frame slot
+     * has its own range of queries, which complete() reads once the slot's fence has signaled. Passes sharing a name
+     * are summed per frame, and the sums are averaged over frames.
+     */
+    class PassTimer {
+    public:
+        PassTimer() = default;
+
+        /**
+         * @param maxPasses Passes timed per frame, the ones after it are not timed.
+         * @param timestampPeriod Nanoseconds per timestamp tick, from VkPhysicalDeviceLimits.
+         */
+        PassTimer(VkDevice logicalDevice, uint32_t frameSlots, uint32_t maxPasses, float timestampPeriod);
+
+        // reset the slot's queries, recorded before the frame's first pass
+        void begin(VkCommandBuffer cmdBuffer, uint32_t frameSlot);
+        void beginPass(VkCommandBuffer cmdBuffer, const std::string& name);
+        void endPass(VkCommandBuffer cmdBuffer);
+
+        /**
+         * Read the passes frameSlot recorded. Only call this after waiting on that slot's fence. Does nothing on a
+         * default constructed timer.
+         */
+        void complete(VkDevice logicalDevice, uint32_t frameSlot);
+
+        // forget every frame so far, e.g. the ones that warmed up
+        void reset();
+
+        [[nodiscard]] bool isEnabled() const;
+
+        // average seconds per frame, by pass name
+        [[nodiscard]] const std::map<std::string, raymarcher::tools::TimeEntries>& getPassTimes() const;
+
+        [[nodiscard]] std::string summary() const;
+
+        void destroy(VkDevice logicalDevice);
+
+    private:
+        VkQueryPool queryPool = VK_NULL_HANDLE;
+        uint32_t maxPasses = 0;
+        float timestampPeriod = 0;
+
+        std::vector<std::vector<std::string>> slotPasses;  // the passes each slot timed, in order
+        uint32_t recordingSlot = 0;
+        bool passOpen = false;
+
+        std::map<std::string, raymarcher::tools::TimeEntries> passTimes;
+    };
+}
+
+#endif //RAYMARCH_PASSTIMER_H
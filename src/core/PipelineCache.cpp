@@ -0,0 +1,187 @@
+#include "PipelineCache.h"
+
+#include <stdexcept>
+#include <fstream>
+#include <sstream>
+#include <iostream>
+#include <cstring>
+#include <filesystem>
+#include <chrono>
+#include <utility>
+
+raymarcher::core::PipelineCache::PipelineCache(VkDevice logicalDevice, VkPhysicalDevice physicalDevice, std::string filepath)
+        : filepath(std::move(filepath)) {
+    VkPhysicalDeviceIDProperties idProperties{
+        .sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_ID_PROPERTIES
+    };
+
+    VkPhysicalDeviceProperties2 properties2{
+        .sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_PROPERTIES_2,
+        .pNext = &idProperties
+    };
+
+    vkGetPhysicalDeviceProperties2(physicalDevice, &properties2);
+
+    expectedHeader.magic = FILE_MAGIC;
+    expectedHeader.vendorID = properties2.properties.vendorID;
+    expectedHeader.deviceID = properties2.properties.deviceID;
+    expectedHeader.driverVersion = properties2.properties.driverVersion;
+    memcpy(expectedHeader.driverUUID, idProperties.driverUUID, VK_UUID_SIZE);
+    memcpy(expectedHeader.pipelineCacheUUID, properties2.properties.pipelineCacheUUID, VK_UUID_SIZE);
+
+    std::vector<char> initialData = readValidatedData();
+    loadedFromDisk = !initialData.empty();
+
+    VkPipelineCacheCreateInfo createInfo{
+        .sType = VK_STRUCTURE_TYPE_PIPELINE_CACHE_CREATE_INFO,
+        .initialDataSize = initialData.size(),
+        .pInitialData = initialData.empty() ? nullptr : initialData.data()
+    };
+
+    if (vkCreatePipelineCache(logicalDevice, &createInfo, nullptr, &pipelineCache) != VK_SUCCESS) {
+        throw std::runtime_error("Failed to create pipeline cache");
+    }
+}
+
+std::vector<char> raymarcher::core::PipelineCache::readValidatedData() const {
+    std::ifstream file(filepath, std::ios::ate | std::ios::binary);
+
+    if (!file.is_open()) {
+        return {};  // no cache yet, which is expected on the first launch
+    }
+
+    auto fileSize = static_cast<size_t>(file.tellg());
+    file.seekg(0);
+
+    FileHeader header{};
+    if (fileSize < sizeof(FileHeader) || !file.read(reinterpret_cast<char*>(&header), sizeof(FileHeader))) {
+        std::cerr << "Pipeline cache at " << filepath << " is truncated, ignoring it\n";
+        return {};
+    }
+
+    bool matches = header.magic == expectedHeader.magic
+            && header.vendorID == expectedHeader.vendorID
+            && header.deviceID == expectedHeader.deviceID
+            && header.driverVersion == expectedHeader.driverVersion
+            && memcmp(header.driverUUID, expectedHeader.driverUUID, VK_UUID_SIZE) == 0
+            && memcmp(header.pipelineCacheUUID, expectedHeader.pipelineCacheUUID, VK_UUID_SIZE) == 0
+            && header.dataSize == fileSize - sizeof(FileHeader);
+
+    if (!matches) {
+        std::cerr << "Pipeline cache at " << filepath << " was written by a different device or driver, ignoring it\n";
+        return {};
+    }
+
+    std::vector<char> data(header.dataSize);
+    file.read(data.data(), static_cast<std::streamsize>(data.size()));
+
+    return data;
+}
+
+VkPipelineCache raymarcher::core::PipelineCache::getHandle() const {
+    return pipelineCache;
+}
+
+void raymarcher::core::PipelineCache::recordCreation(const std::string& pipelineName, double seconds, const VkPipelineCreationFeedback& feedback) {
+    CacheResult result = CacheResult::UNKNOWN;
+
+    if (feedback.flags & VK_PIPELINE_CREATION_FEEDBACK_VALID_BIT) {
+        result = (feedback.flags & VK_PIPELINE_CREATION_FEEDBACK_APPLICATION_PIPELINE_CACHE_HIT_BIT) ? CacheResult::HIT : CacheResult::MISS;
+    }
+
+    std::lock_guard<std::mutex> lock(*recordsMutex);
+    records.push_back(CreationRecord{pipelineName, seconds, result});
+}
+
+std::string raymarcher::core::PipelineCache::summary() const {
+    std::ostringstream oss;
+    oss << "Pipeline cache: " << (loadedFromDisk ? "loaded from " + filepath : "cold start") << "\n";
+
+    std::lock_guard<std::mutex> lock(*recordsMutex);
+
+    double hitTime = 0, missTime = 0, unknownTime = 0;
+    for (const CreationRecord& record : records) {
+        const char* resultName = "unknown";
+
+        switch (record.result) {
+            case CacheResult::HIT:
+                resultName = "hit";
+                hitTime += record.seconds;
+                break;
+            case CacheResult::MISS:
+                resultName = "miss";
+                missTime += record.seconds;
+                break;
+            case CacheResult::UNKNOWN:
+                unknownTime += record.seconds;
+                break;
+        }
+
+        oss << "Pipeline cache " << resultName << " | " << record.pipelineName << ": " << record.seconds * 1000 << "ms\n";
+    }
+
+    oss << "Pipeline cache totals | hit: " << hitTime * 1000 << "ms, miss: " << missTime * 1000 << "ms, unknown: " << unknownTime * 1000 << "ms\n";
+
+    return oss.str();
+}
+
+void raymarcher::core::PipelineCache::save(VkDevice logicalDevice) const {
+    size_t dataSize = 0;
+    // called from the destructor, so failures are reported instead of thrown, the next run just starts cold
+    if (vkGetPipelineCacheData(logicalDevice, pipelineCache, &dataSize, nullptr) != VK_SUCCESS) {
+        std::cerr << "Could not get pipeline cache size\n";
+        return;
+    }
+
+    std::vector<char> data(dataSize);
+    if (vkGetPipelineCacheData(logicalDevice, pipelineCache, &dataSize, data.data()) != VK_SUCCESS) {
+        std::cerr << "Could not get pipeline cache data\n";
+        return;
+    }
+
+    FileHeader header = expectedHeader;
+    header.dataSize = dataSize;
+
+    // write to a temporary file and rename it so concurrent jobs never read a half-written cache
+    std::string tempPath = filepath + ".tmp" + std::to_string(std::chrono::steady_clock::now().time_since_epoch().count());
+    {
+        std::ofstream file(tempPath, std::ios::binary | std::ios::trunc);
+
+        if (!file.is_open()) {
+            std::cerr << "Could not write pipeline cache to " << tempPath << "\n";
+            return;
+        }
+
+        file.write(reinterpret_cast<const char*>(&header), sizeof(FileHeader));
+        file.write(data.data(), static_cast<std::streamsize>(dataSize));
+        file.flush();
+
+        if (!file.good()) {
+            std::cerr << "Could not write pipeline cache to " << tempPath << "\n";
+            file.close();
+
+            std::error_code removeError;
+            std::filesystem::remove(tempPath, removeError);
+            return;
+        }
+    }
+
+    std::error_code error;
+    std::filesystem::rename(tempPath, filepath, error);
+
+    if (error) {
+        std::cerr << "Could not move pipeline cache to " << filepath << ": " << error.message() << "\n";
+
+        std::error_code removeError;
+        std::filesystem::remove(tempPath, removeError);
+    }
+}
+
+void raymarcher::core::PipelineCache::destroy(VkDevice logicalDevice) {
+    if (pipelineCache == VK_NULL_HANDLE) {
+        return;
+    }
+
+    vkDestroyPipelineCache(logicalDevice, pipelineCache, nullptr);
+    pipelineCache = VK_NULL_HANDLE;
+}
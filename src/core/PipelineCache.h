@@ -0,0 +1,75 @@
+#ifndef RAYMARCH_PIPELINECACHE_H
+#define RAYMARCH_PIPELINECACHE_H
+
+#include <vulkan/vulkan.h>
+
+#include <string>
+#include <vector>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+
+namespace raymarcher::core {
+    /**
+     * A VkPipelineCache that is loaded from disk when created and written back with save(). The file is keyed on the
+     * vendor, device, driver version and driver UUID, so data written by a different device or driver is discarded
+     * instead of being handed to the driver.
+     */
+    class PipelineCache {
+    public:
+        PipelineCache() = default;
+        PipelineCache(VkDevice logicalDevice, VkPhysicalDevice physicalDevice, std::string filepath);
+
+        [[nodiscard]] VkPipelineCache getHandle() const;
+
+        /**
+         * Record how long a pipeline took to create and whether the driver served it from this cache. Thread-safe,
+         * since pipelines may be built from a worker pool.
+         * @param pipelineName A name to show in summary(), usually the shader path.
+         * @param seconds The wall-clock creation time.
+         * @param feedback The pipeline feedback chained into the pipeline's create info.
+         */
+        void recordCreation(const std::string& pipelineName, double seconds, const VkPipelineCreationFeedback& feedback);
+
+        [[nodiscard]] std::string summary() const;
+
+        void save(VkDevice logicalDevice) const;
+        void destroy(VkDevice logicalDevice);
+
+    private:
+        struct FileHeader {
+            uint32_t magic;
+            uint32_t vendorID;
+            uint32_t deviceID;
+            uint32_t driverVersion;
+            uint8_t driverUUID[VK_UUID_SIZE];
+            uint8_t pipelineCacheUUID[VK_UUID_SIZE];
+            uint64_t dataSize;
+        };
+
+        enum class CacheResult {
+            HIT,
+            MISS,
+            UNKNOWN  // the driver did not report feedback
+        };
+
+        struct CreationRecord {
+            std::string pipelineName;
+            double seconds;
+            CacheResult result;
+        };
+
+        static constexpr uint32_t FILE_MAGIC = 0x43504d52;  // "RMPC"
+
+        [[nodiscard]] std::vector<char> readValidatedData() const;
+
+        std::string filepath;
+        FileHeader expectedHeader{};
+        bool loadedFromDisk = false;
+        VkPipelineCache pipelineCache = VK_NULL_HANDLE;
+        std::vector<CreationRecord> records;
+        std::unique_ptr<std::mutex> recordsMutex = std::make_unique<std::mutex>();
+    };
+}
+
+#endif //RAYMARCH_PIPELINECACHE_H
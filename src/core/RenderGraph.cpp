@@ -0,0 +1,355 @@
+#include "RenderGraph.h"
+
+#include <stdexcept>
+#include <algorithm>
+#include <sstream>
+
+namespace {
+    struct UsageState {
+        VkImageLayout layout;
+        VkAccessFlags2 access;
+        VkPipelineStageFlags2 stages;
+    };
+
+    UsageState usageState(raymarcher::core::RenderGraph::Usage usage) {
+        using Usage = raymarcher::core::RenderGraph::Usage;
+
+        switch (usage) {
+            case Usage::STORAGE_READ:
+                return {VK_IMAGE_LAYOUT_GENERAL, VK_ACCESS_2_SHADER_STORAGE_READ_BIT, VK_PIPELINE_STAGE_2_COMPUTE_SHADER_BIT};
+            case Usage::STORAGE_WRITE:
+                return {VK_IMAGE_LAYOUT_GENERAL, VK_ACCESS_2_SHADER_STORAGE_WRITE_BIT, VK_PIPELINE_STAGE_2_COMPUTE_SHADER_BIT};
+            case Usage::STORAGE_READ_WRITE:
+                return {VK_IMAGE_LAYOUT_GENERAL, VK_ACCESS_2_SHADER_STORAGE_READ_BIT | VK_ACCESS_2_SHADER_STORAGE_WRITE_BIT, VK_PIPELINE_STAGE_2_COMPUTE_SHADER_BIT};
+            case Usage::TRANSFER_READ:
+                return {VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL, VK_ACCESS_2_TRANSFER_READ_BIT, VK_PIPELINE_STAGE_2_COPY_BIT};
+            case Usage::TRANSFER_WRITE:
+                return {VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, VK_ACCESS_2_TRANSFER_WRITE_BIT, VK_PIPELINE_STAGE_2_COPY_BIT | VK_PIPELINE_STAGE_2_CLEAR_BIT};
+            case Usage::INDIRECT_READ:
+                return {VK_IMAGE_LAYOUT_UNDEFINED, VK_ACCESS_2_INDIRECT_COMMAND_READ_BIT, VK_PIPELINE_STAGE_2_DRAW_INDIRECT_BIT};
+        }
+
+        throw std::runtime_error("Unknown render graph usage");
+    }
+
+    // writes that replace the contents, which move a ping/pong resource on to its other image
+    bool createsVersion(raymarcher::core::RenderGraph::Usage usage) {
+        using Usage = raymarcher::core::RenderGraph::Usage;
+        return usage == Usage::STORAGE_WRITE || usage == Usage::TRANSFER_WRITE;
+    }
+}
+
+VkCommandBuffer raymarcher::core::RenderGraph::PassContext::getCmdBuffer() const {
+    return cmdBuffer;
+}
+
+const raymarcher::core::RenderGraph::PassContext::Slots& raymarcher::core::RenderGraph::PassContext::slotsOf(ResourceId resource) const {
+    auto found = std::find_if(slots.begin(), slots.end(), [&](const Slots& entry) {
+        return entry.resource == resource;
+    });
+
+    if (found == slots.end()) {
+        throw std::runtime_error("Pass did not declare render graph resource " + graph.resources.at(resource).name);
+    }
+
+    return *found;
+}
+
+raymarcher::graphics::Image& raymarcher::core::RenderGraph::PassContext::input(ResourceId resource) const {
+    return *graph.resources[resource].images.at(slotsOf(resource).input);
+}
+
+raymarcher::graphics::Image& raymarcher::core::RenderGraph::PassContext::output(ResourceId resource) const {
+    return *graph.resources[resource].images.at(slotsOf(resource).output);
+}
+
+uint32_t raymarcher::core::RenderGraph::PassContext::inputIndex(ResourceId resource) const {
+    return graph.resources[resource].bindlessIndices.at(slotsOf(resource).input);
+}
+
+uint32_t raymarcher::core::RenderGraph::PassContext::outputIndex(ResourceId resource) const {
+    return graph.resources[resource].bindlessIndices.at(slotsOf(resource).output);
+}
+
+const raymarcher::core::Buffer& raymarcher::core::RenderGraph::PassContext::buffer(ResourceId resource) const {
+    if (graph.resources[resource].buffers.empty()) {
+        throw std::runtime_error("Render graph resource " + graph.resources[resource].name + " is not a buffer");
+    }
+
+    return *graph.resources[resource].buffers.at(slotsOf(resource).input);
+}
+
+const raymarcher::core::Buffer& raymarcher::core::RenderGraph::PassContext::outputBuffer(ResourceId resource) const {
+    if (graph.resources[resource].buffers.empty()) {
+        throw std::runtime_error("Render graph resource " + graph.resources[resource].name + " is not a buffer");
+    }
+
+    return *graph.resources[resource].buffers.at(slotsOf(resource).output);
+}
+
+uint32_t raymarcher::core::RenderGraph::PassContext::bufferIndex(ResourceId resource) const {
+    return graph.resources[resource].bindlessIndices.at(slotsOf(resource).input);
+}
+
+uint32_t raymarcher::core::RenderGraph::PassContext::outputBufferIndex(ResourceId resource) const {
+    return graph.resources[resource].bindlessIndices.at(slotsOf(resource).output);
+}
+
+raymarcher::core::RenderGraph::ResourceId raymarcher::core::RenderGraph::importImage(const std::string& name, raymarcher::graphics::Image& image, uint32_t bindlessIndex, VkImageLayout finalLayout) {
+    resources.push_back(Resource{
+            .name = name,
+            .images = {&image},
+            .bindlessIndices = {bindlessIndex},
+            .finalLayout = finalLayout
+    });
+
+    return static_cast<ResourceId>(resources.size() - 1);
+}
+
+raymarcher::core::RenderGraph::ResourceId raymarcher::core::RenderGraph::importPingPong(const std::string& name, raymarcher::graphics::Image& first, uint32_t firstIndex, raymarcher::graphics::Image& second, uint32_t secondIndex) {
+    resources.push_back(Resource{
+            .name = name,
+            .images = {&first, &second},
+            .bindlessIndices = {firstIndex, secondIndex}
+    });
+
+    return static_cast<ResourceId>(resources.size() - 1);
+}
+
+raymarcher::core::RenderGraph::ResourceId raymarcher::core::RenderGraph::importBuffer(const std::string& name, const Buffer& buffer, uint32_t bindlessIndex) {
+    resources.push_back(Resource{
+            .name = name,
+            .buffers = {&buffer},
+            .bufferStates = std::vector<BufferState>(1),
+            .bindlessIndices = {bindlessIndex}
+    });
+
+    return static_cast<ResourceId>(resources.size() - 1);
+}
+
+raymarcher::core::RenderGraph::ResourceId raymarcher::core::RenderGraph::importPingPongBuffer(const std::string& name, const Buffer& first, uint32_t firstIndex, const Buffer& second, uint32_t secondIndex) {
+    resources.push_back(Resource{
+            .name = name,
+            .buffers = {&first, &second},
+            .bufferStates = std::vector<BufferState>(2),
+            .bindlessIndices = {firstIndex, secondIndex}
+    });
+
+    return static_cast<ResourceId>(resources.size() - 1);
+}
+
+void raymarcher::core::RenderGraph::setImage(ResourceId resource, raymarcher::graphics::Image& image, uint32_t bindlessIndex) {
+    if (resources.at(resource).images.size() != 1) {
+        throw std::runtime_error("Only single imported images can be swapped, not " + resources[resource].name);
+    }
+
+    resources[resource].images[0] = &image;
+    resources[resource].bindlessIndices[0] = bindlessIndex;
+}
+
+void raymarcher::core::RenderGraph::markOutput(ResourceId resource) {
+    resources.at(resource).output = true;
+}
+
+raymarcher::core::RenderGraph::PassId raymarcher::core::RenderGraph::addPass(const std::string& name, const std::vector<Access>& accesses, ExecuteFunc execute, bool sideEffects) {
+    for (const Access& access : accesses) {
+        if (access.resource >= resources.size()) {
+            throw std::runtime_error("Pass " + name + " uses a resource that is not part of the render graph");
+        }
+    }
+
+    passes.push_back(Pass{
+            .name = name,
+            .accesses = accesses,
+            .execute = std::move(execute),
+            .sideEffects = sideEffects
+    });
+
+    return static_cast<PassId>(passes.size() - 1);
+}
+
+void raymarcher::core::RenderGraph::setEnabled(PassId pass, bool enabled) {
+    passes.at(pass).enabled = enabled;
+}
+
+bool raymarcher::core::RenderGraph::writes(Usage usage) {
+    return usage == Usage::STORAGE_WRITE || usage == Usage::STORAGE_READ_WRITE || usage == Usage::TRANSFER_WRITE;
+}
+
+bool raymarcher::core::RenderGraph::reads(Usage usage) {
+    return usage == Usage::STORAGE_READ || usage == Usage::STORAGE_READ_WRITE || usage == Usage::TRANSFER_READ || usage == Usage::INDIRECT_READ;
+}
+
+std::vector<bool> raymarcher::core::RenderGraph::cull() const {
+    std::vector<bool> kept(passes.size(), false);
+    std::vector<bool> needed(resources.size(), false);
+
+    for (size_t i = 0; i < resources.size(); i++) {
+        needed[i] = resources[i].output;
+    }
+
+    // walk back from the outputs. a pass is needed if something later reads what it writes
+    for (size_t i = passes.size(); i-- > 0;) {
+        const Pass& pass = passes[i];
+        if (!pass.enabled) {
+            continue;
+        }
+
+        bool keep = pass.sideEffects || std::any_of(pass.accesses.begin(), pass.accesses.end(), [&](const Access& access) {
+            return writes(access.usage) && needed[access.resource];
+        });
+
+        if (!keep) {
+            continue;
+        }
+
+        kept[i] = true;
+        for (const Access& access : pass.accesses) {
+            if (reads(access.usage)) {
+                needed[access.resource] = true;
+            }
+        }
+    }
+
+    return kept;
+}
+
+void raymarcher::core::RenderGraph::addBarrier(BarrierBatch& barriers, Resource& resource, uint32_t slot, Usage usage) {
+    UsageState state = usageState(usage);
+
+    if (resource.buffers.empty()) {
+        // images track their own state and drop barriers that are not needed
+        barriers.image(*resource.images[slot], state.layout, state.access, state.stages);
+        return;
+    }
+
+    const Buffer& buffer = *resource.buffers[slot];
+    BufferState& bufferState = resource.bufferStates[slot];
+
+    if (writes(usage)) {
+        // wait for the last write, and let earlier reads finish before overwriting
+        VkPipelineStageFlags2 waitStages = bufferState.writeStages | bufferState.readStages;
+        if (waitStages != VK_PIPELINE_STAGE_2_NONE) {
+            barriers.buffer(buffer, waitStages, bufferState.writeAccess, state.stages, state.access);
+        }
+
+        bufferState = BufferState{
+                .writeStages = state.stages,
+                .writeAccess = state.access & (VK_ACCESS_2_SHADER_STORAGE_WRITE_BIT | VK_ACCESS_2_TRANSFER_WRITE_BIT)
+        };
+        return;
+    }
+
+    bool visible = (state.stages & ~bufferState.readStages) == 0 && (state.access & ~bufferState.readAccess) == 0;
+    if (bufferState.writeStages != VK_PIPELINE_STAGE_2_NONE && !visible) {
+        barriers.buffer(buffer, bufferState.writeStages, bufferState.writeAccess, state.stages, state.access);
+    }
+
+    bufferState.readStages |= state.stages;
+    bufferState.readAccess |= state.access;
+}
+
+void raymarcher::core::RenderGraph::execute(VkCommandBuffer cmdBuffer, PassTimer* timer) {
+    std::vector<bool> kept = cull();
+
+    // how many times each resource was replaced this frame. version v of a ping/pong resource lives in image or
+    //  buffer (current + v) % 2
+    std::vector<uint32_t> versions(resources.size(), 0);
+    std::vector<bool> written(resources.size(), false);
+
+    BarrierBatch barriers;
+
+    for (size_t i = 0; i < passes.size(); i++) {
+        if (!kept[i]) {
+            continue;
+        }
+
+        Pass& pass = passes[i];
+        PassContext context{*this, cmdBuffer};
+
+        // resolve every read before any write, so a pass can read one version and write the next
+        for (const Access& access : pass.accesses) {
+            const Resource& resource = resources[access.resource];
+            const uint32_t slotCount = resource.slotCount();
+
+            bool declared = std::any_of(context.slots.begin(), context.slots.end(), [&](const PassContext::Slots& slots) {
+                return slots.resource == access.resource;
+            });
+
+            if (!declared) {
+                uint32_t slot = (resource.current + versions[access.resource]) % slotCount;
+                context.slots.push_back(PassContext::Slots{access.resource, slot, slot});
+            }
+        }
+
+        for (const Access& access : pass.accesses) {
+            if (!writes(access.usage)) {
+                continue;
+            }
+
+            const Resource& resource = resources[access.resource];
+            const uint32_t slotCount = resource.slotCount();
+
+            if (createsVersion(access.usage) && slotCount > 1) {
+                versions[access.resource]++;
+            }
+
+            auto slots = std::find_if(context.slots.begin(), context.slots.end(), [&](const PassContext::Slots& entry) {
+                return entry.resource == access.resource;
+            });
+
+            slots->output = (resource.current + versions[access.resource]) % slotCount;
+            written[access.resource] = true;
+        }
+
+        for (const Access& access : pass.accesses) {
+            const PassContext::Slots& slots = context.slotsOf(access.resource);
+            addBarrier(barriers, resources[access.resource], writes(access.usage) ? slots.output : slots.input, access.usage);
+        }
+
+        if (timer != nullptr) {
+            timer->beginPass(cmdBuffer, pass.name);
+        }
+
+        barriers.flush(cmdBuffer);
+        pass.execute(context);
+
+        if (timer != nullptr) {
+            timer->endPass(cmdBuffer);
+        }
+    }
+
+    for (size_t i = 0; i < resources.size(); i++) {
+        Resource& resource = resources[i];
+        const uint32_t slotCount = resource.slotCount();
+        resource.current = (resource.current + versions[i]) % slotCount;
+
+        // hand written images over in the layout whoever uses them after the frame expects
+        if (written[i] && resource.finalLayout != VK_IMAGE_LAYOUT_UNDEFINED) {
+            barriers.image(*resource.images[resource.current], resource.finalLayout, VK_ACCESS_2_NONE, VK_PIPELINE_STAGE_2_NONE);
+        }
+    }
+
+    barriers.flush(cmdBuffer);
+}
+
+raymarcher::graphics::Image& raymarcher::core::RenderGraph::current(ResourceId resource) const {
+    const Resource& entry = resources.at(resource);
+    return *entry.images.at(entry.current);
+}
+
+uint32_t raymarcher::core::RenderGraph::passCount() const {
+    return static_cast<uint32_t>(passes.size());
+}
+
+std::string raymarcher::core::RenderGraph::summary() const {
+    std::ostringstream oss;
+    oss << "Render graph: " << passes.size() << " passes, " << resources.size() << " resources (";
+
+    for (size_t i = 0; i < passes.size(); i++) {
+        oss << (i == 0 ? "" : " -> ") << passes[i].name;
+    }
+
+    oss << ")\n";
+    return oss.str();
+}
@@ -0,0 +1,170 @@
+#ifndef RAYMARCH_RENDERGRAPH_H
+#define RAYMARCH_RENDERGRAPH_H
+
+#include <vulkan/vulkan.h>
+
+#include <vector>
+#include <string>
+#include <functional>
+#include <cstdint>
+#include <algorithm>
+
+#include "Buffer.h"
+#include "BarrierBatch.h"
+#include "PassTimer.h"
+#include "../graphics/Image.h"
+
+namespace raymarcher::core {
+    /**
+     * Records a frame from passes that declare which resources they read and write. Passes run in the order they were
+     * added, and the graph derives everything in between: the barriers before each pass, which physical image a
+     * ping/pong resource resolves to, and the bindless indices handed to the pass. Passes whose results are never
+     * used are culled. Passes without a dependency on each other get no barrier in between, so they can overlap.
+     */
+    class RenderGraph {
+    public:
+        using ResourceId = uint32_t;
+        using PassId = uint32_t;
+
+        enum class Usage {
+            STORAGE_READ,
+            STORAGE_WRITE,  // writes a new version. on a ping/pong resource this is the other image or buffer
+            STORAGE_READ_WRITE,  // modifies the current version in place
+            TRANSFER_READ,
+            TRANSFER_WRITE,  // copies and clears
+            INDIRECT_READ  // dispatch arguments, buffers only
+        };
+
+        struct Access {
+            ResourceId resource;
+            Usage usage;
+        };
+
+        /**
+         * What a pass gets while recording: its command buffer, and the resources it declared, resolved for this frame.
+         */
+        class PassContext {
+        public:
+            PassContext(const RenderGraph& graph, VkCommandBuffer cmdBuffer) : graph(graph), cmdBuffer(cmdBuffer) {}
+
+            [[nodiscard]] VkCommandBuffer getCmdBuffer() const;
+
+            // the image holding the version this pass reads, and the one it writes to
+            [[nodiscard]] raymarcher::graphics::Image& input(ResourceId resource) const;
+            [[nodiscard]] raymarcher::graphics::Image& output(ResourceId resource) const;
+            [[nodiscard]] uint32_t inputIndex(ResourceId resource) const;
+            [[nodiscard]] uint32_t outputIndex(ResourceId resource) const;
+
+            // like input() and output(), for buffer resources
+            [[nodiscard]] const Buffer& buffer(ResourceId resource) const;
+            [[nodiscard]] const Buffer& outputBuffer(ResourceId resource) const;
+            [[nodiscard]] uint32_t bufferIndex(ResourceId resource) const;
+            [[nodiscard]] uint32_t outputBufferIndex(ResourceId resource) const;
+
+        private:
+            friend class RenderGraph;
+
+            struct Slots {
+                ResourceId resource;
+                uint32_t input;
+                uint32_t output;
+            };
+
+            [[nodiscard]] const Slots& slotsOf(ResourceId resource) const;
+
+            const RenderGraph& graph;
+            VkCommandBuffer cmdBuffer;
+            std::vector<Slots> slots;
+        };
+
+        using ExecuteFunc = std::function<void(PassContext&)>;
+
+        RenderGraph() = default;
+
+        /**
+         * Add an image the graph does not own. The bindless index is what passes get from inputIndex() and
+         * outputIndex(). When finalLayout is set, the image is left in it once the frame has written it.
+         */
+        ResourceId importImage(const std::string& name, raymarcher::graphics::Image& image, uint32_t bindlessIndex, VkImageLayout finalLayout = VK_IMAGE_LAYOUT_UNDEFINED);
+
+        // two images that take turns holding the current version. first holds it before the first frame
+        ResourceId importPingPong(const std::string& name, raymarcher::graphics::Image& first, uint32_t firstIndex, raymarcher::graphics::Image& second, uint32_t secondIndex);
+
+        ResourceId importBuffer(const std::string& name, const Buffer& buffer, uint32_t bindlessIndex);
+
+        // two buffers that take turns holding the current version, like importPingPong() for images
+        ResourceId importPingPongBuffer(const std::string& name, const Buffer& first, uint32_t firstIndex, const Buffer& second, uint32_t secondIndex);
+
+        // swap the image behind an imported image, e.g. for per frame slot resources
+        void setImage(ResourceId resource, raymarcher::graphics::Image& image, uint32_t bindlessIndex);
+
+        /**
+         * Keep whatever writes resource, its contents are used after the frame.
+         */
+        void markOutput(ResourceId resource);
+
+        /**
+         * @param sideEffects Never cull the pass, even if nothing in the graph reads what it writes.
+         */
+        PassId addPass(const std::string& name, const std::vector<Access>& accesses, ExecuteFunc execute, bool sideEffects = false);
+
+        // disabled passes are skipped this frame, as if they were culled
+        void setEnabled(PassId pass, bool enabled);
+
+        /**
+         * Record every pass that is enabled and not culled, with the barriers needed before each of them.
+         * @param timer Times every recorded pass, including its barriers. The caller begins the timer's frame.
+         */
+        void execute(VkCommandBuffer cmdBuffer, PassTimer* timer = nullptr);
+
+        // the image holding the latest version of resource
+        [[nodiscard]] raymarcher::graphics::Image& current(ResourceId resource) const;
+
+        [[nodiscard]] uint32_t passCount() const;
+
+        [[nodiscard]] std::string summary() const;
+
+    private:
+        // last write to a buffer and the reads it has been made visible to, like Image tracks it for images
+        struct BufferState {
+            VkPipelineStageFlags2 writeStages = VK_PIPELINE_STAGE_2_NONE;
+            VkAccessFlags2 writeAccess = VK_ACCESS_2_NONE;
+            VkPipelineStageFlags2 readStages = VK_PIPELINE_STAGE_2_NONE;
+            VkAccessFlags2 readAccess = VK_ACCESS_2_NONE;
+        };
+
+        struct Resource {
+            std::string name;
+            std::vector<raymarcher::graphics::Image*> images;
+            std::vector<const Buffer*> buffers;  // either images or buffers are set
+            std::vector<BufferState> bufferStates;  // one per buffer
+            std::vector<uint32_t> bindlessIndices;
+            VkImageLayout finalLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+            bool output = false;
+            uint32_t current = 0;  // the image or buffer holding version 0 of this frame
+
+            // how many images or buffers take turns holding the versions
+            [[nodiscard]] uint32_t slotCount() const {
+                return static_cast<uint32_t>(std::max<size_t>(std::max(images.size(), buffers.size()), 1));
+            }
+        };
+
+        struct Pass {
+            std::string name;
+            std::vector<Access> accesses;
+            ExecuteFunc execute;
+            bool sideEffects = false;
+            bool enabled = true;
+        };
+
+        [[nodiscard]] static bool writes(Usage usage);
+        [[nodiscard]] static bool reads(Usage usage);
+        [[nodiscard]] std::vector<bool> cull() const;
+        void addBarrier(BarrierBatch& barriers, Resource& resource, uint32_t slot, Usage usage);
+
+        std::vector<Resource> resources;
+        std::vector<Pass> passes;
+    };
+}
+
+#endif //RAYMARCH_RENDERGRAPH_H
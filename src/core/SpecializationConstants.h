@@ -0,0 +1,69 @@
+#ifndef RAYMARCH_SPECIALIZATIONCONSTANTS_H
+#define RAYMARCH_SPECIALIZATIONCONSTANTS_H
+
+#include <vulkan/vulkan.h>
+
+#include <vector>
+#include <cstdint>
+#include <cstring>
+#include <stdexcept>
+#include <type_traits>
+
+namespace raymarcher::core {
+    /**
+     * Values for a shader's specialization constants (layout(constant_id = N) and local_size_x_id = N in GLSL),
+     * packed into the layout VkSpecializationInfo expects. IDs that the shader does not declare are ignored by Vulkan.
+     */
+    class SpecializationConstants {
+    public:
+        SpecializationConstants() = default;
+
+        template<typename T>
+        SpecializationConstants& set(uint32_t constantID, T value) {
+            static_assert(std::is_same_v<T, int32_t> || std::is_same_v<T, uint32_t> || std::is_same_v<T, float>,
+                          "Specialization constants must be 32-bit ints or floats");
+
+            for (const VkSpecializationMapEntry& entry : entries) {
+                if (entry.constantID == constantID) {
+                    throw std::runtime_error("Specialization constant ID set more than once");
+                }
+            }
+
+            entries.push_back(VkSpecializationMapEntry{
+                .constantID = constantID,
+                .offset = static_cast<uint32_t>(data.size()),
+                .size = sizeof(T)
+            });
+
+            data.resize(data.size() + sizeof(T));
+            memcpy(data.data() + data.size() - sizeof(T), &value, sizeof(T));
+
+            return *this;
+        }
+
+        [[nodiscard]] bool empty() const {
+            return entries.empty();
+        }
+
+        /**
+         * The returned pointer refers to this object and is valid until it is modified, copied or destroyed.
+         */
+        [[nodiscard]] const VkSpecializationInfo* getInfo() const {
+            info = VkSpecializationInfo{
+                .mapEntryCount = static_cast<uint32_t>(entries.size()),
+                .pMapEntries = entries.data(),
+                .dataSize = data.size(),
+                .pData = data.data()
+            };
+
+            return &info;
+        }
+
+    private:
+        std::vector<VkSpecializationMapEntry> entries;
+        std::vector<uint8_t> data;
+        mutable VkSpecializationInfo info{};
+    };
+}
+
+#endif //RAYMARCH_SPECIALIZATIONCONSTANTS_H
@@ -0,0 +1,186 @@
+#include "StagingRing.h"
+
+#include <stdexcept>
+#include <cstring>
+#include <string>
+
+#include "../graphics/Image.h"
+#include "BarrierBatch.h"
+
+raymarcher::core::StagingRing::StagingRing(VkDevice logicalDevice, MemoryAllocator& allocator, VkDeviceSize capacity)
+        : capacity(capacity) {
+    buffer = Buffer{
+            logicalDevice, allocator, capacity,
+            VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
+            static_cast<VkMemoryAllocateFlags>(0),
+            VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT
+    };
+
+    if (buffer.getMappedData() == nullptr) {
+        throw std::runtime_error("Staging ring memory is not mapped");
+    }
+}
+
+VkDeviceSize raymarcher::core::StagingRing::allocate(VkDeviceSize size, VkDeviceSize alignment) {
+    if (size > capacity) {
+        throw std::runtime_error("Upload of " + std::to_string(size) + " bytes does not fit in the staging ring");
+    }
+
+    if (regions.empty()) {
+        head = 0;
+    }
+
+    // the oldest region still in use. everything from tail up to head is taken, wrapping around the end
+    VkDeviceSize tail = regions.empty() ? 0 : regions.front().begin;
+    bool wrapped = !regions.empty() && head <= tail;
+
+    VkDeviceSize offset = (head + alignment - 1) / alignment * alignment;
+
+    if (!wrapped && offset + size > capacity) {
+        // does not fit before the end, start over at the front
+        offset = 0;
+        wrapped = true;
+    }
+
+    if (wrapped && !regions.empty() && offset + size > tail) {
+        throw std::runtime_error("Staging ring is full, uploads must wait for frames in flight to finish");
+    }
+
+    head = offset + size;
+    regions.push_back(Region{offset, head, PENDING_SLOT});
+
+    return offset;
+}
+
+void raymarcher::core::StagingRing::uploadToBuffer(const Buffer& dst, const void* data, VkDeviceSize size, VkDeviceSize dstOffset) {
+    if (size == 0) {
+        return;
+    }
+
+    VkDeviceSize srcOffset = allocate(size, 16);
+    memcpy(static_cast<char*>(buffer.getMappedData()) + srcOffset, data, static_cast<size_t>(size));
+
+    pendingCopies.push_back(PendingCopy{
+            .srcOffset = srcOffset,
+            .size = size,
+            .dstBuffer = dst.getHandle(),
+            .dstImage = VK_NULL_HANDLE,
+            .dstOffset = dstOffset
+    });
+}
+
+void raymarcher::core::StagingRing::uploadToImage(raymarcher::graphics::Image& dst, const void* data, VkDeviceSize size) {
+    VkDeviceSize srcOffset = allocate(size, 16);  // also satisfies the texel size alignment of every color format used here
+    memcpy(static_cast<char*>(buffer.getMappedData()) + srcOffset, data, static_cast<size_t>(size));
+
+    pendingCopies.push_back(PendingCopy{
+            .srcOffset = srcOffset,
+            .size = size,
+            .dstBuffer = VK_NULL_HANDLE,
+            .dstImage = dst.getImage(),
+            .imageExtent = {dst.getWidth(), dst.getHeight(), 1}
+    });
+
+    // flush() transitions the image, so anything recorded after it has to start from the copy
+    dst.setTrackedState(VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, VK_ACCESS_2_TRANSFER_WRITE_BIT, VK_PIPELINE_STAGE_2_COPY_BIT);
+}
+
+void raymarcher::core::StagingRing::flush(VkCommandBuffer cmdBuffer, uint32_t frameSlot) {
+    if (pendingCopies.empty()) {
+        return;
+    }
+
+    // every image is moved out of UNDEFINED by one barrier, ahead of all the copies
+    BarrierBatch barriers;
+
+    for (const PendingCopy& copy : pendingCopies) {
+        if (copy.dstImage == VK_NULL_HANDLE) {
+            continue;
+        }
+
+        barriers.image(VkImageMemoryBarrier2{
+                .sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER_2,
+                .srcStageMask = VK_PIPELINE_STAGE_2_NONE,
+                .srcAccessMask = VK_ACCESS_2_NONE,
+                .dstStageMask = VK_PIPELINE_STAGE_2_COPY_BIT,
+                .dstAccessMask = VK_ACCESS_2_TRANSFER_WRITE_BIT,
+                .oldLayout = VK_IMAGE_LAYOUT_UNDEFINED,
+                .newLayout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
+                .srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED,
+                .dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED,
+                .image = copy.dstImage,
+                .subresourceRange = {
+                        .aspectMask = VK_IMAGE_ASPECT_COLOR_BIT,
+                        .baseMipLevel = 0,
+                        .levelCount = 1,
+                        .baseArrayLayer = 0,
+                        .layerCount = 1
+                }
+        });
+    }
+
+    barriers.flush(cmdBuffer);
+
+    for (const PendingCopy& copy : pendingCopies) {
+        if (copy.dstBuffer != VK_NULL_HANDLE) {
+            VkBufferCopy region{
+                    .srcOffset = copy.srcOffset,
+                    .dstOffset = copy.dstOffset,
+                    .size = copy.size
+            };
+
+            vkCmdCopyBuffer(cmdBuffer, buffer.getHandle(), copy.dstBuffer, 1, &region);
+            continue;
+        }
+
+        VkBufferImageCopy region{
+                .bufferOffset = copy.srcOffset,
+                .bufferRowLength = 0,
+                .bufferImageHeight = 0,
+                .imageSubresource = {
+                        .aspectMask = VK_IMAGE_ASPECT_COLOR_BIT,
+                        .mipLevel = 0,
+                        .baseArrayLayer = 0,
+                        .layerCount = 1
+                },
+                .imageOffset = {0, 0, 0},
+                .imageExtent = copy.imageExtent
+        };
+
+        vkCmdCopyBufferToImage(cmdBuffer, buffer.getHandle(), copy.dstImage, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, 1, &region);
+    }
+
+    // buffers are not tracked like images, so make the uploads visible to everything that may read them this frame
+    barriers.memory(
+            VK_PIPELINE_STAGE_2_COPY_BIT, VK_ACCESS_2_TRANSFER_WRITE_BIT,
+            VK_PIPELINE_STAGE_2_COMPUTE_SHADER_BIT | VK_PIPELINE_STAGE_2_TRANSFER_BIT | VK_PIPELINE_STAGE_2_DRAW_INDIRECT_BIT,
+            VK_ACCESS_2_SHADER_STORAGE_READ_BIT | VK_ACCESS_2_SHADER_STORAGE_WRITE_BIT | VK_ACCESS_2_TRANSFER_READ_BIT | VK_ACCESS_2_TRANSFER_WRITE_BIT
+            | VK_ACCESS_2_INDIRECT_COMMAND_READ_BIT
+    );
+    barriers.flush(cmdBuffer);
+
+    pendingCopies.clear();
+
+    for (Region& region : regions) {
+        if (region.frameSlot == PENDING_SLOT) {
+            region.frameSlot = frameSlot;
+        }
+    }
+}
+
+void raymarcher::core::StagingRing::release(uint32_t frameSlot) {
+    // frames finish in submission order, so the slot being reused always owns the oldest regions
+    while (!regions.empty() && regions.front().frameSlot == frameSlot) {
+        regions.pop_front();
+    }
+}
+
+bool raymarcher::core::StagingRing::hasPendingUploads() const {
+    return !pendingCopies.empty();
+}
+
+void raymarcher::core::StagingRing::destroy(VkDevice logicalDevice) {
+    buffer.destroy(logicalDevice);
+    regions.clear();
+    pendingCopies.clear();
+}
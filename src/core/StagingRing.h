@@ -0,0 +1,90 @@
+#ifndef RAYMARCH_STAGINGRING_H
+#define RAYMARCH_STAGINGRING_H
+
+#include <vulkan/vulkan.h>
+
+#include <deque>
+#include <vector>
+#include <cstdint>
+
+#include "Buffer.h"
+#include "MemoryAllocator.h"
+
+// forward declare
+namespace raymarcher::graphics {
+    class Image;
+}
+
+namespace raymarcher::core {
+    /**
+     * A persistently mapped host visible buffer that all host to device uploads go through. Uploads are copied into
+     * the ring right away and the copy commands are recorded by flush() into the next frame's command buffer, so the
+     * CPU never waits on a one-time command buffer. Regions are tagged with the frame slot that flushed them and reused
+     * once release() is called for that slot, i.e. once its fence has signaled.
+     */
+    class StagingRing {
+    public:
+        static constexpr VkDeviceSize DEFAULT_CAPACITY = 16ull * 1024 * 1024;
+
+        StagingRing() = default;
+        StagingRing(VkDevice logicalDevice, MemoryAllocator& allocator, VkDeviceSize capacity = DEFAULT_CAPACITY);
+
+        /**
+         * Queue a copy of size bytes from data into dst at dstOffset. data can be freed as soon as this returns.
+         */
+        void uploadToBuffer(const Buffer& dst, const void* data, VkDeviceSize size, VkDeviceSize dstOffset = 0);
+
+        /**
+         * Queue a copy of tightly packed texels into the whole image. The image is left in
+         * VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, and its tracked state is updated so its next transition() waits on the copy.
+         */
+        void uploadToImage(raymarcher::graphics::Image& dst, const void* data, VkDeviceSize size);
+
+        /**
+         * Record every queued copy, followed by a barrier that makes them visible to compute shaders and transfers.
+         * @param frameSlot The frame slot cmdBuffer belongs to.
+         */
+        void flush(VkCommandBuffer cmdBuffer, uint32_t frameSlot);
+
+        /**
+         * Recycle the regions flushed by frameSlot. Only call this after waiting on that slot's fences.
+         */
+        void release(uint32_t frameSlot);
+
+        [[nodiscard]] bool hasPendingUploads() const;
+
+        void destroy(VkDevice logicalDevice);
+
+    private:
+        static constexpr uint32_t PENDING_SLOT = UINT32_MAX;  // queued but not flushed yet
+
+        struct Region {
+            VkDeviceSize begin;
+            VkDeviceSize end;
+            uint32_t frameSlot;
+        };
+
+        struct PendingCopy {
+            VkDeviceSize srcOffset;
+            VkDeviceSize size;
+
+            // exactly one of these is set
+            VkBuffer dstBuffer;
+            VkImage dstImage;
+
+            VkDeviceSize dstOffset;
+            VkExtent3D imageExtent;
+        };
+
+        [[nodiscard]] VkDeviceSize allocate(VkDeviceSize size, VkDeviceSize alignment);
+
+        Buffer buffer;
+        VkDeviceSize capacity = 0;
+        VkDeviceSize head = 0;  // where the next region starts, unless it has to wrap
+
+        std::deque<Region> regions;  // oldest first
+        std::vector<PendingCopy> pendingCopies;
+    };
+}
+
+#endif //RAYMARCH_STAGINGRING_H
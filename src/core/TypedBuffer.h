@@ -0,0 +1,68 @@
+#ifndef RAYMARCH_TYPEDBUFFER_H
+#define RAYMARCH_TYPEDBUFFER_H
+
+#include <vulkan/vulkan.h>
+
+#include <vector>
+#include <type_traits>
+#include <cstdint>
+
+#include "Buffer.h"
+#include "MemoryAllocator.h"
+#include "StagingRing.h"
+
+namespace raymarcher::core {
+    /**
+     * A Buffer holding an array of T. It knows its element count, so dispatch sizes and push constants never have
+     * to be derived from byte sizes. T is expected to be a polyglot struct whose size equals its std430 array stride,
+     * which the polyglot headers check with static_asserts.
+     */
+    template<typename T>
+    class TypedBuffer {
+        static_assert(std::is_trivially_copyable_v<T>, "GPU array elements are copied byte for byte");
+        static_assert(std::is_standard_layout_v<T>, "GPU array elements need a predictable layout");
+        static_assert(sizeof(T) % 4 == 0, "std430 array strides are a multiple of 4 bytes");
+
+    public:
+        TypedBuffer() = default;
+
+        // host visible, filled right away
+        TypedBuffer(VkDevice logicalDevice, MemoryAllocator& allocator, const std::vector<T>& data, VkBufferUsageFlags usage, VkMemoryAllocateFlags allocFlags, VkMemoryPropertyFlags memFlags)
+                : buffer(logicalDevice, allocator, data, usage, allocFlags, memFlags), count(static_cast<uint32_t>(data.size())) {}
+
+        // device local, filled through the staging ring
+        TypedBuffer(VkDevice logicalDevice, MemoryAllocator& allocator, StagingRing& stagingRing, const std::vector<T>& data, VkBufferUsageFlags usage, VkMemoryAllocateFlags allocFlags)
+                : buffer(logicalDevice, allocator, stagingRing, data, usage, allocFlags), count(static_cast<uint32_t>(data.size())) {}
+
+        // device local, left uninitialized for the GPU to fill
+        TypedBuffer(VkDevice logicalDevice, MemoryAllocator& allocator, uint32_t count, VkBufferUsageFlags usage, VkMemoryAllocateFlags allocFlags)
+                : buffer(logicalDevice, allocator, sizeof(T) * count, usage, allocFlags, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT), count(count) {}
+
+        [[nodiscard]] const Buffer& getBuffer() const {
+            return buffer;
+        }
+
+        [[nodiscard]] uint32_t getCount() const {
+            return count;
+        }
+
+        [[nodiscard]] static constexpr VkDeviceSize getStride() {
+            return sizeof(T);
+        }
+
+        [[nodiscard]] VkDeviceSize getSize() const {
+            return buffer.getSize();
+        }
+
+        void destroy(VkDevice logicalDevice) {
+            buffer.destroy(logicalDevice);
+            count = 0;
+        }
+
+    private:
+        Buffer buffer;
+        uint32_t count = 0;
+    };
+}
+
+#endif //RAYMARCH_TYPEDBUFFER_H
@@ -6,8 +6,17 @@
 #include <stb_image.h>
 
 #include "../tools/vktools.h"
+#include "../core/StagingRing.h"
+#include "../core/BarrierBatch.h"
+
+namespace {
+    // every access that makes a later access to the image need a barrier
+    constexpr VkAccessFlags2 WRITE_ACCESS_MASK = VK_ACCESS_2_SHADER_WRITE_BIT | VK_ACCESS_2_SHADER_STORAGE_WRITE_BIT |
+            VK_ACCESS_2_TRANSFER_WRITE_BIT | VK_ACCESS_2_COLOR_ATTACHMENT_WRITE_BIT | VK_ACCESS_2_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT |
+            VK_ACCESS_2_HOST_WRITE_BIT | VK_ACCESS_2_MEMORY_WRITE_BIT;
+}
 
-raymarcher::graphics::Image::Image(VkDevice logicalDevice, VkPhysicalDevice physicalDevice, VkCommandPool cmdPool, VkQueue queue, const std::string& filepath) {
+raymarcher::graphics::Image::Image(VkDevice logicalDevice, raymarcher::core::MemoryAllocator& allocator, raymarcher::core::StagingRing& stagingRing, const std::string& filepath) {
     // read image with stb: https://solarianprogrammer.com/2019/06/10/c-programming-reading-writing-images-stb_image-libraries/
     int imageWidth, imageHeight, channels;
 
@@ -18,12 +27,12 @@ raymarcher::graphics::Image::Image(VkDevice logicalDevice, VkPhysicalDevice phys
         throw std::runtime_error("Could not load image at path: " + filepath);
     }
 
-    load(logicalDevice, physicalDevice, cmdPool, queue, imgData, imageWidth, imageHeight);
+    load(logicalDevice, allocator, stagingRing, imgData, imageWidth, imageHeight);
     stbi_image_free(imgData);
 }
 
-raymarcher::graphics::Image::Image(VkDevice logicalDevice, VkPhysicalDevice physicalDevice, VkCommandPool cmdPool,
-                                   VkQueue queue, std::byte* imageData, size_t imageLengthBytes) {
+raymarcher::graphics::Image::Image(VkDevice logicalDevice, raymarcher::core::MemoryAllocator& allocator, raymarcher::core::StagingRing& stagingRing,
+                                   std::byte* imageData, size_t imageLengthBytes) {
     int imageWidth, imageHeight, channels;
     stbi_set_flip_vertically_on_load(false);
     uint8_t* imgData = stbi_load_from_memory(
@@ -36,65 +45,35 @@ raymarcher::graphics::Image::Image(VkDevice logicalDevice, VkPhysicalDevice phys
         throw std::runtime_error("Failed to load image from memory: " + std::string(stbi_failure_reason()));
     }
 
-    load(logicalDevice, physicalDevice, cmdPool, queue, imgData, imageWidth, imageHeight);
+    load(logicalDevice, allocator, stagingRing, imgData, imageWidth, imageHeight);
     stbi_image_free(imgData);
 }
 
-void raymarcher::graphics::Image::load(VkDevice logicalDevice, VkPhysicalDevice physicalDevice, VkCommandPool cmdPool, VkQueue queue, uint8_t *imgData, int imageWidth, int imageHeight) {
+void raymarcher::graphics::Image::load(VkDevice logicalDevice, raymarcher::core::MemoryAllocator& allocator, raymarcher::core::StagingRing& stagingRing, uint8_t *imgData, int imageWidth, int imageHeight) {
     width = static_cast<uint32_t>(imageWidth);
     height = static_cast<uint32_t>(imageHeight);
 
-    std::vector<uint8_t> imgDataVec = std::vector<uint8_t>(imgData, imgData + width * height * 4);
-
-    raymarcher::core::Buffer stagingBuffer = raymarcher::core::Buffer{
-            logicalDevice, physicalDevice, imgDataVec,
-            VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
-            VK_MEMORY_ALLOCATE_DEVICE_ADDRESS_BIT,
-            VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT
-    };
-
     VkFormat format = VK_FORMAT_R8G8B8A8_UNORM;  // Do not use gamma correction since it is already assumed to have it
     VkImageUsageFlags usage = VK_IMAGE_USAGE_TRANSFER_DST_BIT | VK_IMAGE_USAGE_SAMPLED_BIT;
     VkMemoryPropertyFlags properties = VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT;
 
-    createImage(logicalDevice, physicalDevice, width, height, format, VK_IMAGE_TILING_OPTIMAL, usage, properties);
+    createImage(logicalDevice, allocator, width, height, format, VK_IMAGE_TILING_OPTIMAL, usage, properties);
     createImageView(logicalDevice, format);
 
-    raymarcher::core::CmdBuffer cmdBuffer{logicalDevice, cmdPool, true};
-
-    transition(cmdBuffer.getHandle(), VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, VK_ACCESS_TRANSFER_WRITE_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT);
-    VkBufferImageCopy region{
-            .bufferOffset = 0,
-            .bufferRowLength = 0,
-            .bufferImageHeight = 0,
-            .imageSubresource{
-                    .aspectMask = VK_IMAGE_ASPECT_COLOR_BIT,
-                    .mipLevel = 0,
-                    .baseArrayLayer = 0,
-                    .layerCount = 1
-            },
-            .imageOffset = {0, 0, 0},
-            .imageExtent = {width, height, 1}
-    };
-
-    vkCmdCopyBufferToImage(cmdBuffer.getHandle(), stagingBuffer.getHandle(), image, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, 1, &region);
-
-    cmdBuffer.endWaitSubmit(logicalDevice, queue);
-
-    cmdBuffer.destroy(logicalDevice);
-    stagingBuffer.destroy(logicalDevice);
+    stagingRing.uploadToImage(*this, imgData, static_cast<VkDeviceSize>(width) * height * 4);
 }
 
 
-raymarcher::graphics::Image::Image(VkDevice logicalDevice, VkPhysicalDevice physicalDevice, uint32_t width, uint32_t height, VkFormat format, VkImageUsageFlags usage, VkMemoryPropertyFlags properties)
-        : width(width), height(height), image(VK_NULL_HANDLE), imageView(VK_NULL_HANDLE), imageMemory(VK_NULL_HANDLE) {
-    createImage(logicalDevice, physicalDevice, width, height, format, VK_IMAGE_TILING_OPTIMAL, usage, properties);
+raymarcher::graphics::Image::Image(VkDevice logicalDevice, raymarcher::core::MemoryAllocator& allocator, uint32_t width, uint32_t height, VkFormat format, VkImageUsageFlags usage, VkMemoryPropertyFlags properties, const std::vector<uint32_t>& sharedQueueFamilies)
+        : width(width), height(height), image(VK_NULL_HANDLE), imageView(VK_NULL_HANDLE) {
+    createImage(logicalDevice, allocator, width, height, format, VK_IMAGE_TILING_OPTIMAL, usage, properties, sharedQueueFamilies);
     createImageView(logicalDevice, format);
 }
 
-void raymarcher::graphics::Image::createImage(VkDevice logicalDevice, VkPhysicalDevice physicalDevice, uint32_t width, uint32_t height,
+void raymarcher::graphics::Image::createImage(VkDevice logicalDevice, raymarcher::core::MemoryAllocator& allocator, uint32_t width, uint32_t height,
                                               VkFormat format, VkImageTiling tiling, VkImageUsageFlags usage,
-                                              VkMemoryPropertyFlags properties) {
+                                              VkMemoryPropertyFlags properties, const std::vector<uint32_t>& sharedQueueFamilies) {
+    bool concurrent = sharedQueueFamilies.size() > 1;
 
     VkImageCreateInfo imageCreateInfo{
             .sType = VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO,
@@ -111,7 +90,9 @@ void raymarcher::graphics::Image::createImage(VkDevice logicalDevice, VkPhysical
             .samples = VK_SAMPLE_COUNT_1_BIT,
             .tiling = tiling,
             .usage = usage,
-            .sharingMode = VK_SHARING_MODE_EXCLUSIVE,
+            .sharingMode = concurrent ? VK_SHARING_MODE_CONCURRENT : VK_SHARING_MODE_EXCLUSIVE,
+            .queueFamilyIndexCount = concurrent ? static_cast<uint32_t>(sharedQueueFamilies.size()) : 0u,
+            .pQueueFamilyIndices = concurrent ? sharedQueueFamilies.data() : nullptr,
             .initialLayout = VK_IMAGE_LAYOUT_UNDEFINED
     };
 
@@ -122,17 +103,12 @@ void raymarcher::graphics::Image::createImage(VkDevice logicalDevice, VkPhysical
     VkMemoryRequirements memRequirements;
     vkGetImageMemoryRequirements(logicalDevice, image, &memRequirements);
 
-    VkMemoryAllocateInfo allocInfo{
-            .sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO,
-            .allocationSize = memRequirements.size,
-            .memoryTypeIndex = vktools::findMemoryType(physicalDevice, memRequirements.memoryTypeBits, properties)
-    };
+    this->allocator = &allocator;
+    allocation = allocator.allocate(logicalDevice, memRequirements, properties, 0, tiling == VK_IMAGE_TILING_LINEAR);
 
-    if (vkAllocateMemory(logicalDevice, &allocInfo, nullptr, &imageMemory)) {
-        throw std::runtime_error("Failed to allocate image memory");
+    if (vkBindImageMemory(logicalDevice, image, allocation.memory, allocation.offset) != VK_SUCCESS) {
+        throw std::runtime_error("Failed to bind image memory");
     }
-
-    vkBindImageMemory(logicalDevice, image, imageMemory, 0);
 }
 
 void raymarcher::graphics::Image::createImageView(VkDevice logicalDevice, VkFormat imageFormat) {
@@ -163,10 +139,41 @@ VkImageView raymarcher::graphics::Image::getImageView() const {
     return imageView;
 }
 
-void raymarcher::graphics::Image::transition(VkCommandBuffer cmdBuffer, VkImageLayout newLayout, VkAccessFlags newAccessMask, VkPipelineStageFlags newPipelineStages) {
-    VkImageMemoryBarrier rayTracingToGeneralBarrier{
-            .sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER,
-            .srcAccessMask = accessMask,
+uint32_t raymarcher::graphics::Image::getWidth() const {
+    return width;
+}
+
+uint32_t raymarcher::graphics::Image::getHeight() const {
+    return height;
+}
+
+void raymarcher::graphics::Image::transition(VkCommandBuffer cmdBuffer, VkImageLayout newLayout, VkAccessFlags2 newAccessMask, VkPipelineStageFlags2 newPipelineStages) {
+    raymarcher::core::BarrierBatch barriers;
+    barriers.image(*this, newLayout, newAccessMask, newPipelineStages);
+    barriers.flush(cmdBuffer);
+}
+
+std::optional<VkImageMemoryBarrier2> raymarcher::graphics::Image::barrierTo(VkImageLayout newLayout, VkAccessFlags2 newAccessMask, VkPipelineStageFlags2 newPipelineStages) {
+    bool writes = (newAccessMask & WRITE_ACCESS_MASK) != 0;
+    bool sameLayout = newLayout == layout;
+
+    if (sameLayout && !writes) {
+        bool visible = (newPipelineStages & ~readStages) == 0 && (newAccessMask & ~readAccess) == 0;
+
+        // nothing was written since the last barrier, or these reads already wait on it
+        if (writeStages == VK_PIPELINE_STAGE_2_NONE || visible) {
+            readStages |= newPipelineStages;
+            readAccess |= newAccessMask;
+            return std::nullopt;
+        }
+    }
+
+    // layout transitions and writes also have to wait for earlier reads, which only needs an execution dependency
+    VkImageMemoryBarrier2 barrier{
+            .sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER_2,
+            .srcStageMask = (sameLayout && !writes) ? writeStages : writeStages | readStages,
+            .srcAccessMask = writeAccess,
+            .dstStageMask = newPipelineStages,
             .dstAccessMask = newAccessMask,
             .oldLayout = layout,
             .newLayout = newLayout,
@@ -182,21 +189,44 @@ void raymarcher::graphics::Image::transition(VkCommandBuffer cmdBuffer, VkImageL
             }
     };
 
-    vkCmdPipelineBarrier(
-            cmdBuffer,
-            pipelineStages,
-            newPipelineStages,
-            0,
-            0, nullptr,
-            0, nullptr,
-            1, &rayTracingToGeneralBarrier
-    );
+    if (sameLayout && !writes) {
+        // the write stays the last one, it is now visible to these reads as well
+        readStages |= newPipelineStages;
+        readAccess |= newAccessMask;
+    } else {
+        setTrackedState(newLayout, newAccessMask, newPipelineStages);
+    }
+
+    return barrier;
+}
+
+void raymarcher::graphics::Image::setTrackedState(VkImageLayout newLayout, VkAccessFlags2 newAccessMask, VkPipelineStageFlags2 newPipelineStages) {
+    layout = newLayout;
+    writeStages = newPipelineStages;
+
+    if ((newAccessMask & WRITE_ACCESS_MASK) != 0) {
+        writeAccess = newAccessMask & WRITE_ACCESS_MASK;
+        readStages = VK_PIPELINE_STAGE_2_NONE;
+        readAccess = VK_ACCESS_2_NONE;
+    } else {
+        // a layout transition without a write. later reads in other stages still have to wait for it
+        writeAccess = VK_ACCESS_2_NONE;
+        readStages = newPipelineStages;
+        readAccess = newAccessMask;
+    }
 }
 
 void raymarcher::graphics::Image::destroy(VkDevice logicalDevice) {
-    vkDestroyImage(logicalDevice, image, nullptr);
-    vkFreeMemory(logicalDevice, imageMemory, nullptr);
     vkDestroyImageView(logicalDevice, imageView, nullptr);
+    vkDestroyImage(logicalDevice, image, nullptr);
+
+    if (allocator != nullptr) {
+        allocator->free(logicalDevice, allocation);
+    }
+
+    image = VK_NULL_HANDLE;
+    imageView = VK_NULL_HANDLE;
+    allocation = {};
 }
 
 void raymarcher::graphics::Image::copyToBuffer(VkCommandBuffer cmdBuffer, VkBuffer dstBuffer) {
@@ -220,3 +250,27 @@ void raymarcher::graphics::Image::copyToBuffer(VkCommandBuffer cmdBuffer, VkBuff
             1, &region
     );
 }
+
+void raymarcher::graphics::Image::copyToImage(VkCommandBuffer cmdBuffer, const Image& dstImage) {
+    VkImageSubresourceLayers subresource{
+            .aspectMask = VK_IMAGE_ASPECT_COLOR_BIT,
+            .mipLevel = 0,
+            .baseArrayLayer = 0,
+            .layerCount = 1
+    };
+
+    VkImageCopy region{
+            .srcSubresource = subresource,
+            .srcOffset = {0, 0, 0},
+            .dstSubresource = subresource,
+            .dstOffset = {0, 0, 0},
+            .extent = {width, height, 1}
+    };
+
+    vkCmdCopyImage(
+            cmdBuffer,
+            getImage(), VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL,
+            dstImage.getImage(), VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
+            1, &region
+    );
+}
@@ -4,38 +4,70 @@
 #include <vulkan/vulkan.h>
 #include <string>
 #include <vector>
+#include <optional>
+
+#include "../core/MemoryAllocator.h"
+
+// forward declare
+namespace raymarcher::core {
+    class StagingRing;
+}
 
 namespace raymarcher::graphics {
     class Image {
     public:
         Image() = default;
-        Image(VkDevice logicalDevice, VkPhysicalDevice physicalDevice, VkCommandPool cmdPool, VkQueue queue, const std::string& filepath);
-        Image(VkDevice logicalDevice, VkPhysicalDevice physicalDevice, VkCommandPool cmdPool,
-              VkQueue queue, std::byte *imageData, size_t imageLengthBytes);
-        Image(VkDevice logicalDevice, VkPhysicalDevice physicalDevice, uint32_t width, uint32_t height, VkFormat format, VkImageUsageFlags usage, VkMemoryPropertyFlags memProps);
+        // the texels are uploaded through the staging ring, so the image is only valid after the ring's next flush
+        Image(VkDevice logicalDevice, raymarcher::core::MemoryAllocator& allocator, raymarcher::core::StagingRing& stagingRing, const std::string& filepath);
+        Image(VkDevice logicalDevice, raymarcher::core::MemoryAllocator& allocator, raymarcher::core::StagingRing& stagingRing,
+              std::byte *imageData, size_t imageLengthBytes);
+        /**
+         * @param sharedQueueFamilies When more than one family is given, the image is created with concurrent sharing
+         *  between them, so it can be used on several queues without ownership transfers.
+         */
+        Image(VkDevice logicalDevice, raymarcher::core::MemoryAllocator& allocator, uint32_t width, uint32_t height, VkFormat format, VkImageUsageFlags usage, VkMemoryPropertyFlags memProps, const std::vector<uint32_t>& sharedQueueFamilies = {});
 
         [[nodiscard]] VkImage getImage() const;
         [[nodiscard]] VkImageView getImageView() const;
+        [[nodiscard]] uint32_t getWidth() const;
+        [[nodiscard]] uint32_t getHeight() const;
 
-        void transition(VkCommandBuffer cmdBuffer, VkImageLayout newLayout, VkAccessFlags newAccessMask, VkPipelineStageFlags newPipelineStages);
+        // records a barrier of its own. prefer collecting transitions in a BarrierBatch when there are several
+        void transition(VkCommandBuffer cmdBuffer, VkImageLayout newLayout, VkAccessFlags2 newAccessMask, VkPipelineStageFlags2 newPipelineStages);
         void copyToBuffer(VkCommandBuffer cmdBuffer, VkBuffer dstBuffer);
+        void copyToImage(VkCommandBuffer cmdBuffer, const Image& dstImage);
+
+        /**
+         * The barrier needed before accessing the image with newAccessMask in newPipelineStages, and assume it gets
+         * recorded. Empty when the image already is in newLayout and the last write is visible to those reads.
+         */
+        [[nodiscard]] std::optional<VkImageMemoryBarrier2> barrierTo(VkImageLayout newLayout, VkAccessFlags2 newAccessMask, VkPipelineStageFlags2 newPipelineStages);
+
+        /**
+         * Tell the image about a barrier that was recorded without transition(), e.g. by the staging ring.
+         */
+        void setTrackedState(VkImageLayout newLayout, VkAccessFlags2 newAccessMask, VkPipelineStageFlags2 newPipelineStages);
 
         void destroy(VkDevice logicalDevice);
     private:
-        void load(VkDevice logicalDevice, VkPhysicalDevice physicalDevice, VkCommandPool cmdPool, VkQueue queue, uint8_t* imgData, int imageWidth, int imageHeight);
+        void load(VkDevice logicalDevice, raymarcher::core::MemoryAllocator& allocator, raymarcher::core::StagingRing& stagingRing, uint8_t* imgData, int imageWidth, int imageHeight);
 
-        void createImage(VkDevice logicalDevice, VkPhysicalDevice physicalDevice, uint32_t width, uint32_t height, VkFormat format, VkImageTiling tiling, VkImageUsageFlags usage, VkMemoryPropertyFlags properties);
+        void createImage(VkDevice logicalDevice, raymarcher::core::MemoryAllocator& allocator, uint32_t width, uint32_t height, VkFormat format, VkImageTiling tiling, VkImageUsageFlags usage, VkMemoryPropertyFlags properties, const std::vector<uint32_t>& sharedQueueFamilies = {});
         void createImageView(VkDevice logicalDevice, VkFormat imageFormat);
 
         uint32_t width = 0, height = 0;
 
         VkImage image = VK_NULL_HANDLE;
-        VkDeviceMemory imageMemory = VK_NULL_HANDLE;
+        raymarcher::core::MemoryAllocator* allocator = nullptr;
+        raymarcher::core::Allocation allocation;
         VkImageView imageView = VK_NULL_HANDLE;
 
+        // the last write, and the reads it has been made visible to since
         VkImageLayout layout = VK_IMAGE_LAYOUT_UNDEFINED;
-        VkAccessFlags accessMask = static_cast<VkAccessFlags>(0);
-        VkPipelineStageFlags pipelineStages = VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT;
+        VkAccessFlags2 writeAccess = VK_ACCESS_2_NONE;
+        VkPipelineStageFlags2 writeStages = VK_PIPELINE_STAGE_2_NONE;
+        VkAccessFlags2 readAccess = VK_ACCESS_2_NONE;
+        VkPipelineStageFlags2 readStages = VK_PIPELINE_STAGE_2_NONE;
     };
 }
 
@@ -5,19 +5,30 @@
 #include <utility>
 
 raymarcher::graphics::Shader::Shader(VkDevice logicalDevice, const std::string& path, VkShaderStageFlagBits shaderStage, std::string  entryPoint)
-    : shaderStage(shaderStage), entryPoint(std::move(entryPoint)) {
+    : path(path), shaderStage(shaderStage), entryPoint(std::move(entryPoint)) {
     shaderModule = createShaderModule(logicalDevice, readFile(path));
 }
 
+raymarcher::graphics::Shader::Shader(VkDevice logicalDevice, const std::string& path, VkShaderStageFlagBits shaderStage, raymarcher::core::SpecializationConstants specialization, std::string entryPoint)
+    : Shader(logicalDevice, path, shaderStage, std::move(entryPoint)) {
+    this->specialization = std::move(specialization);
+}
+
 VkPipelineShaderStageCreateInfo raymarcher::graphics::Shader::pipelineShaderStageCreateInfo() const {
+    // the specialization info points into this shader, so it must outlive the pipeline creation call
     return VkPipelineShaderStageCreateInfo{
         .sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO,
         .stage = shaderStage,
         .module = shaderModule,
-        .pName = entryPoint.c_str()
+        .pName = entryPoint.c_str(),
+        .pSpecializationInfo = specialization.empty() ? nullptr : specialization.getInfo()
     };
 }
 
+const std::string& raymarcher::graphics::Shader::getPath() const {
+    return path;
+}
+
 std::vector<char> raymarcher::graphics::Shader::readFile(const std::string &filepath) {
     // std::ios::ate - start at the end of the file
     std::ifstream file(filepath, std::ios::ate | std::ios::binary);
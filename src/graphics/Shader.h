@@ -5,21 +5,26 @@
 #include <string>
 #include <vector>
 
+#include "../core/SpecializationConstants.h"
 
 namespace raymarcher::graphics {
     class Shader {
     public:
         Shader() = default;
         Shader(VkDevice logicalDevice, const std::string& path, VkShaderStageFlagBits shaderStage, std::string entryPoint = "main");
+        Shader(VkDevice logicalDevice, const std::string& path, VkShaderStageFlagBits shaderStage, raymarcher::core::SpecializationConstants specialization, std::string entryPoint = "main");
 
         void destroy(VkDevice logicalDevice);
 
         [[nodiscard]] VkPipelineShaderStageCreateInfo pipelineShaderStageCreateInfo() const;
+        [[nodiscard]] const std::string& getPath() const;
 
     private:
+        std::string path;
         VkShaderModule shaderModule = VK_NULL_HANDLE;
         VkShaderStageFlagBits shaderStage = static_cast<VkShaderStageFlagBits>(0);
         std::string entryPoint;
+        raymarcher::core::SpecializationConstants specialization;
 
         static std::vector<char> readFile(const std::string& filepath);
         static VkShaderModule createShaderModule(VkDevice logicalDevice, const std::vector<char>& code);
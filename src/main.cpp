@@ -1,10 +1,230 @@
 #include <iostream>
+#include <string>
+#include <vector>
+#include <cctype>
 #include "Raymarcher.h"
 
+// parses "WIDTHxHEIGHT", e.g. "1920x1080"
+static bool parseExtent(const std::string& text, uint32_t& width, uint32_t& height) {
+    size_t separator = text.find('x');
+    if (separator == std::string::npos || separator == 0 || separator + 1 == text.size()) {
+        return false;
+    }
+
+    try {
+        width = static_cast<uint32_t>(std::stoul(text.substr(0, separator)));
+        height = static_cast<uint32_t>(std::stoul(text.substr(separator + 1)));
+    } catch (const std::exception&) {
+        return false;
+    }
+
+    return width > 0 && height > 0;
+}
+
+// runs headless once per agent count from 10^3 to 10^8, and prints the GPU time of every pass, with the throughput of
+//  the passes that scale with the agents. counts the device cannot hold are reported and skipped before anything is
+//  created for them
+static int runScalingBenchmark(RaymarcherConfig config) {
+    struct Result {
+        uint32_t agents;
+        std::string pass;
+        double seconds;
+        bool agentPass;
+    };
+
+    std::vector<Result> results;
+
+    config.headless = true;
+    config.headlessSnapshot = false;
+    config.timePasses = true;
+    config.agentLifetime = 0;
+
+    // the device every run picks, to check each count against its limits without creating a logical device
+    VkInstance instance = VK_NULL_HANDLE;
+    VkPhysicalDevice physicalDevice = VK_NULL_HANDLE;
+    bool passTiming = false;
+
+    try {
+        instance = vktools::createInstance(true);
+        physicalDevice = vktools::pickPhysicalDevice(instance, VK_NULL_HANDLE);
+        passTiming = Raymarcher::supportsPassTiming(physicalDevice);
+    } catch (const std::exception& e) {
+        vkDestroyInstance(instance, nullptr);
+        std::cerr << e.what() << std::endl;
+        return 1;
+    }
+
+    if (!passTiming) {
+        vkDestroyInstance(instance, nullptr);
+        std::cerr << "The device's simulation queue does not support timestamps, so the benchmark cannot time passes" << std::endl;
+        return 1;
+    }
+
+    for (uint32_t agents = 1000; agents <= 100000000; agents *= 10) {
+        // the first step spawns every agent, the timer leaves it out
+        config.agentCapacity = agents;
+        config.agentSpawnRate = agents;
+
+        try {
+            Raymarcher::checkDeviceLimits(config, physicalDevice);
+        } catch (const std::exception& e) {
+            std::cerr << "Skipped " << agents << " agents: " << e.what() << std::endl;
+            continue;
+        }
+
+        try {
+            Raymarcher raymarcher{config};
+            raymarcher.renderLoop();
+
+            for (const auto& [pass, time] : raymarcher.getPassTimer().getPassTimes()) {
+                results.push_back(Result{agents, pass, time.averageTime, raymarcher.isAgentPass(pass)});
+            }
+        } catch (const std::exception& e) {
+            std::cerr << "Failed " << agents << " agents: " << e.what() << std::endl;
+        }
+    }
+
+    vkDestroyInstance(instance, nullptr);
+
+    // image passes cost the same for every count, so they only get a time
+    std::cout << "agents, pass, ms per step, million agents per second\n";
+    for (const Result& result : results) {
+        std::cout << result.agents << ", " << result.pass << ", " << result.seconds * 1000 << ", ";
+
+        if (result.agentPass && result.seconds > 0) {
+            std::cout << result.agents / result.seconds / 1e6;
+        }
+
+        std::cout << "\n";
+    }
+
+    return results.empty() ? 1 : 0;
+}
+
+int main(int argc, char** argv) {
+    RaymarcherConfig config{};
+    bool benchmark = false;
+
+    // usage: raymarcher [--headless [steps]] [--benchmark [steps]] [--resolution WxH] [--window WxH] [--blur gaussian|box] [--sigma S]
+    //  [--trail-format r16f|r32f|r32ui] [--deposit store|atomic|histogram] [--sort-interval N] [--capacity N]
+    //  [--spawn N] [--lifetime S]
+    for (int i = 1; i < argc; i++) {
+        std::string arg = argv[i];
+
+        if (arg == "--headless" || arg == "--benchmark") {
+            config.headless = true;
+            benchmark = arg == "--benchmark";
+
+            if (benchmark) {
+                config.headlessSteps = 100;
+            }
+
+            if (i + 1 < argc && std::isdigit(static_cast<unsigned char>(argv[i + 1][0]))) {
+                try {
+                    config.headlessSteps = static_cast<uint32_t>(std::stoul(argv[++i]));
+                } catch (const std::exception&) {
+                    std::cerr << "Expected a number of steps after " << arg << std::endl;
+                    return 1;
+                }
+            }
+        } else if ((arg == "--resolution" || arg == "--window") && i + 1 < argc) {
+            uint32_t width, height;
+            if (!parseExtent(argv[++i], width, height)) {
+                std::cerr << "Expected WIDTHxHEIGHT after " << arg << std::endl;
+                return 1;
+            }
+
+            if (arg == "--resolution") {
+                config.simulationWidth = width;
+                config.simulationHeight = height;
+            } else {
+                config.windowWidth = static_cast<int>(width);
+                config.windowHeight = static_cast<int>(height);
+            }
+        } else if (arg == "--blur" && i + 1 < argc) {
+            std::string mode = argv[++i];
+
+            if (mode == "gaussian") {
+                config.blurMode = BlurMode::GAUSSIAN;
+            } else if (mode == "box") {
+                config.blurMode = BlurMode::BOX;
+            } else {
+                std::cerr << "Expected gaussian or box after --blur" << std::endl;
+                return 1;
+            }
+        } else if (arg == "--trail-format" && i + 1 < argc) {
+            std::string format = argv[++i];
+
+            if (format == "r16f") {
+                config.trailFormat = VK_FORMAT_R16_SFLOAT;
+            } else if (format == "r32f") {
+                config.trailFormat = VK_FORMAT_R32_SFLOAT;
+            } else if (format == "r32ui") {
+                config.trailFormat = VK_FORMAT_R32_UINT;
+            } else {
+                std::cerr << "Expected r16f, r32f or r32ui after --trail-format" << std::endl;
+                return 1;
+            }
+        } else if (arg == "--deposit" && i + 1 < argc) {
+            std::string mode = argv[++i];
+
+            if (mode == "store") {
+                config.depositMode = DepositMode::STORE;
+            } else if (mode == "atomic") {
+                config.depositMode = DepositMode::ATOMIC;
+            } else if (mode == "histogram") {
+                config.depositMode = DepositMode::HISTOGRAM;
+            } else {
+                std::cerr << "Expected store, atomic or histogram after --deposit" << std::endl;
+                return 1;
+            }
+        } else if (arg == "--sort-interval" && i + 1 < argc) {
+            try {
+                config.agentSortInterval = static_cast<uint32_t>(std::stoul(argv[++i]));
+            } catch (const std::exception&) {
+                std::cerr << "Expected a number of steps after --sort-interval" << std::endl;
+                return 1;
+            }
+        } else if ((arg == "--capacity" || arg == "--spawn") && i + 1 < argc) {
+            uint32_t count;
+            try {
+                count = static_cast<uint32_t>(std::stoul(argv[++i]));
+            } catch (const std::exception&) {
+                std::cerr << "Expected a number of agents after " << arg << std::endl;
+                return 1;
+            }
+
+            if (arg == "--capacity") {
+                config.agentCapacity = count;
+            } else {
+                config.agentSpawnRate = count;
+            }
+        } else if (arg == "--lifetime" && i + 1 < argc) {
+            try {
+                config.agentLifetime = std::stof(argv[++i]);
+            } catch (const std::exception&) {
+                std::cerr << "Expected a number of seconds after --lifetime" << std::endl;
+                return 1;
+            }
+        } else if (arg == "--sigma" && i + 1 < argc) {
+            try {
+                config.blurSigma = std::stof(argv[++i]);
+            } catch (const std::exception&) {
+                std::cerr << "Expected a number after --sigma" << std::endl;
+                return 1;
+            }
+        } else {
+            std::cerr << "Unknown argument: " << arg << std::endl;
+            return 1;
+        }
+    }
+
+    if (benchmark) {
+        return runScalingBenchmark(config);
+    }
 
-int main() {
     try {
-        Raymarcher raymarcher{};
+        Raymarcher raymarcher{config};
         raymarcher.renderLoop();
     } catch (const std::exception& e) {
         std::cerr << e.what() << std::endl;
@@ -1,6 +1,7 @@
 #include "Clock.h"
 
 #include <sstream>
+#include <chrono>
 
 void raymarcher::tools::TimeEntries::addEntry(double timing) {
     if (recordings == 0) {
@@ -16,7 +17,9 @@ void raymarcher::tools::TimeEntries::addEntry(double timing) {
 raymarcher::tools::Clock::Clock() : creationTime(getTime()) {}
 
 double raymarcher::tools::Clock::getTime() {
-    return glfwGetTime();
+    // steady_clock instead of glfwGetTime() so the clock also works in headless runs where GLFW is never initialized
+    using namespace std::chrono;
+    return duration<double>(steady_clock::now().time_since_epoch()).count();
 }
 
 double raymarcher::tools::Clock::getAge() const {
@@ -5,8 +5,6 @@
 #include <string>
 #include <vector>
 
-#include "../window/Window.h"
-
 namespace raymarcher::tools {
     struct TimeEntries {
         unsigned int recordings = 0;
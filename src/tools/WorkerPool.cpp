@@ -0,0 +1,45 @@
+#include "WorkerPool.h"
+
+#include <algorithm>
+
+raymarcher::tools::WorkerPool::WorkerPool(unsigned int threadCount) {
+    threadCount = std::max(threadCount, 1u);
+
+    for (unsigned int i = 0; i < threadCount; i++) {
+        workers.emplace_back([this]() { workerLoop(); });
+    }
+}
+
+raymarcher::tools::WorkerPool::~WorkerPool() {
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        stopping = true;
+    }
+
+    condition.notify_all();
+
+    for (std::thread& worker : workers) {
+        worker.join();
+    }
+}
+
+void raymarcher::tools::WorkerPool::workerLoop() {
+    while (true) {
+        std::function<void()> task;
+
+        {
+            std::unique_lock<std::mutex> lock(mutex);
+            condition.wait(lock, [this]() { return stopping || !tasks.empty(); });
+
+            // drain the queue before stopping so no future is left without a value
+            if (tasks.empty()) {
+                return;
+            }
+
+            task = std::move(tasks.front());
+            tasks.pop();
+        }
+
+        task();
+    }
+}
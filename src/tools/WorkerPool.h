@@ -0,0 +1,60 @@
+#ifndef RAYMARCH_WORKERPOOL_H
+#define RAYMARCH_WORKERPOOL_H
+
+#include <vector>
+#include <queue>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <functional>
+#include <future>
+#include <memory>
+#include <type_traits>
+
+namespace raymarcher::tools {
+    /**
+     * A fixed-size pool of worker threads that run submitted tasks in FIFO order. Used to overlap slow, thread-safe
+     * driver work (such as pipeline compilation) with the rest of startup. The destructor finishes all queued tasks
+     * before joining the threads.
+     */
+    class WorkerPool {
+    public:
+        explicit WorkerPool(unsigned int threadCount);
+        ~WorkerPool();
+
+        WorkerPool(const WorkerPool&) = delete;
+        WorkerPool& operator=(const WorkerPool&) = delete;
+
+        /**
+         * Queue a task on the pool.
+         * @return A future holding the task's result, or the exception it threw.
+         */
+        template<typename F>
+        std::future<std::invoke_result_t<F>> submit(F&& task) {
+            using ResultType = std::invoke_result_t<F>;
+
+            // std::function needs a copyable callable, so the move-only packaged_task lives behind a shared_ptr
+            auto packagedTask = std::make_shared<std::packaged_task<ResultType()>>(std::forward<F>(task));
+            std::future<ResultType> future = packagedTask->get_future();
+
+            {
+                std::lock_guard<std::mutex> lock(mutex);
+                tasks.emplace([packagedTask]() { (*packagedTask)(); });
+            }
+
+            condition.notify_one();
+            return future;
+        }
+
+    private:
+        void workerLoop();
+
+        std::vector<std::thread> workers;
+        std::queue<std::function<void()>> tasks;
+        std::mutex mutex;
+        std::condition_variable condition;
+        bool stopping = false;
+    };
+}
+
+#endif //RAYMARCH_WORKERPOOL_H
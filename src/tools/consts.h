@@ -9,20 +9,33 @@ namespace consts {
         "VK_LAYER_KHRONOS_validation"
     };
 
-    // array size + 1 with RT validation enabled
-    const std::array<const char*, 9> DEVICE_EXTENSIONS{
-        VK_KHR_SWAPCHAIN_EXTENSION_NAME,
-        VK_KHR_SHADER_FLOAT_CONTROLS_EXTENSION_NAME,
-        VK_EXT_DESCRIPTOR_INDEXING_EXTENSION_NAME,
-        VK_KHR_BUFFER_DEVICE_ADDRESS_EXTENSION_NAME,
+    // Device extensions are split into tiers. Required extensions must be present for a device to be picked at all,
+    //  present extensions are only required when rendering to a window, and optional extensions are enabled when
+    //  the device supports them and reported through vktools::DeviceCapabilities.
+    // Everything the compute path needs (descriptor indexing, buffer device address, SPIR-V 1.4, float controls) is
+    //  core in Vulkan 1.3, so there are currently no required extensions beyond the API version. The descriptor
+    //  indexing features the bindless table relies on are still optional in 1.3, and are checked by
+    //  vktools::isDeviceSuitable() like a required extension.
+    const std::array<const char*, 0> REQUIRED_DEVICE_EXTENSIONS{};
+
+    const std::array<const char*, 1> PRESENT_DEVICE_EXTENSIONS{
+        VK_KHR_SWAPCHAIN_EXTENSION_NAME
+    };
+
+    // each one is enabled only when the device has it, see vktools::queryDeviceCapabilities(). the array size has to
+    //  grow by one when the ray tracing validation extension below is uncommented
+    const std::array<const char*, 5> OPTIONAL_DEVICE_EXTENSIONS{
         VK_KHR_DEFERRED_HOST_OPERATIONS_EXTENSION_NAME,
-        VK_KHR_SPIRV_1_4_EXTENSION_NAME,
         VK_KHR_ACCELERATION_STRUCTURE_EXTENSION_NAME,
         VK_KHR_RAY_TRACING_PIPELINE_EXTENSION_NAME,
         VK_KHR_SHADER_NON_SEMANTIC_INFO_EXTENSION_NAME,  // for debug printf
+        VK_KHR_PUSH_DESCRIPTOR_EXTENSION_NAME,
 //        "VK_NV_ray_tracing_validation"
     };
 
+    // relative to the working directory, like the shader paths
+    const char* const PIPELINE_CACHE_PATH = "pipeline_cache.bin";
+
 #ifdef NDEBUG
     const bool ENABLE_VALIDATION_LAYERS = false;
 #else
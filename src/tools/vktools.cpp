@@ -13,6 +13,7 @@
 #include "GLFW/glfw3.h"
 
 #include "consts.h"
+#include "Clock.h"
 
 uint32_t vktools::findMemoryType(VkPhysicalDevice physicalDevice, uint32_t typeFilter, VkMemoryPropertyFlags properties) {
     VkPhysicalDeviceMemoryProperties memProperties;
@@ -55,11 +56,15 @@ bool vktools::hasValidationLayerSupport() {
     return true;
 }
 
-std::vector<const char*> getRequiredExtensions() {
-    uint32_t glfwExtensionCount = 0;
-    const char** glfwExtensions = glfwGetRequiredInstanceExtensions(&glfwExtensionCount);
+std::vector<const char*> getRequiredExtensions(bool headless) {
+    std::vector<const char*> extensions;
 
-    std::vector<const char*> extensions(glfwExtensions, glfwExtensions + glfwExtensionCount);
+    // surface extensions are only needed when presenting to a window
+    if (!headless) {
+        uint32_t glfwExtensionCount = 0;
+        const char** glfwExtensions = glfwGetRequiredInstanceExtensions(&glfwExtensionCount);
+        extensions.assign(glfwExtensions, glfwExtensions + glfwExtensionCount);
+    }
 
     // validation layer extension
     if (consts::ENABLE_VALIDATION_LAYERS) {
@@ -69,6 +74,32 @@ std::vector<const char*> getRequiredExtensions() {
     return extensions;
 }
 
+std::vector<const char*> getRequiredDeviceExtensions(VkSurfaceKHR surface) {
+    std::vector<const char*> extensions(consts::REQUIRED_DEVICE_EXTENSIONS.begin(), consts::REQUIRED_DEVICE_EXTENSIONS.end());
+
+    // a headless device has nothing to present to, so it does not need a swapchain
+    if (surface != VK_NULL_HANDLE) {
+        extensions.insert(extensions.end(), consts::PRESENT_DEVICE_EXTENSIONS.begin(), consts::PRESENT_DEVICE_EXTENSIONS.end());
+    }
+
+    return extensions;
+}
+
+std::set<std::string> getAvailableDeviceExtensions(VkPhysicalDevice device) {
+    uint32_t extensionCount;
+    vkEnumerateDeviceExtensionProperties(device, nullptr, &extensionCount, nullptr);
+
+    std::vector<VkExtensionProperties> availableExtensions(extensionCount);
+    vkEnumerateDeviceExtensionProperties(device, nullptr, &extensionCount, availableExtensions.data());
+
+    std::set<std::string> extensionNames;
+    for (const auto& extension : availableExtensions) {
+        extensionNames.insert(extension.extensionName);
+    }
+
+    return extensionNames;
+}
+
 VKAPI_ATTR VkBool32 VKAPI_CALL vktools::debugCallback(
         VkDebugUtilsMessageSeverityFlagBitsEXT messageSeverity,
         VkDebugUtilsMessageTypeFlagsEXT messageType,
@@ -110,29 +141,41 @@ vktools::QueueFamilyIndices vktools::findQueueFamilies(VkSurfaceKHR surface, VkP
     std::vector<VkQueueFamilyProperties> queueFamilies(queueFamilyCount);
     vkGetPhysicalDeviceQueueFamilyProperties(physicalDevice, &queueFamilyCount, queueFamilies.data());
 
-    int i = 0;
+    std::optional<uint32_t> firstComputeFamily;
+
+    uint32_t i = 0;
     for (const auto& queueFamily : queueFamilies) {
         // graphics family
-        if (queueFamily.queueFlags & VK_QUEUE_GRAPHICS_BIT) {
+        if ((queueFamily.queueFlags & VK_QUEUE_GRAPHICS_BIT) && !indices.graphicsFamily.has_value()) {
             indices.graphicsFamily = i;
         }
 
-        // present support
-        VkBool32 presentSupport = false;
-        vkGetPhysicalDeviceSurfaceSupportKHR(physicalDevice, i, surface, &presentSupport);
+        // compute family, for devices without graphics support (some compute-only and CPU implementations)
+        if ((queueFamily.queueFlags & VK_QUEUE_COMPUTE_BIT) && !firstComputeFamily.has_value()) {
+            firstComputeFamily = i;
+        }
 
-        if (presentSupport) {
-            indices.presentFamily = i;
+        // async compute family. no early exit, since these are usually listed after the graphics family
+        if ((queueFamily.queueFlags & VK_QUEUE_COMPUTE_BIT) && !(queueFamily.queueFlags & VK_QUEUE_GRAPHICS_BIT) && !indices.asyncComputeFamily.has_value()) {
+            indices.asyncComputeFamily = i;
         }
 
-        // early exit
-        if (indices.isComplete()) {
-            break;
+        // present support (headless runs have no surface to present to)
+        if (surface != VK_NULL_HANDLE && !indices.presentFamily.has_value()) {
+            VkBool32 presentSupport = false;
+            vkGetPhysicalDeviceSurfaceSupportKHR(physicalDevice, i, surface, &presentSupport);
+
+            if (presentSupport) {
+                indices.presentFamily = i;
+            }
         }
 
         i++;
     }
 
+    // prefer the graphics family so that compute and display work can share a single queue
+    indices.computeFamily = indices.graphicsFamily.has_value() ? indices.graphicsFamily : firstComputeFamily;
+
     return indices;
 }
 
@@ -176,21 +219,19 @@ uint64_t vktools::getDeviceLocalMemory(VkPhysicalDevice device) {
     return deviceLocalMemorySize;
 }
 
-bool vktools::isDeviceSuitable(VkPhysicalDevice device) {
-    // Check if all required extensions are supported
-    uint32_t extensionCount;
-    vkEnumerateDeviceExtensionProperties(device, nullptr, &extensionCount, nullptr);
-
-    std::vector<VkExtensionProperties> availableExtensions(extensionCount);
-    vkEnumerateDeviceExtensionProperties(device, nullptr, &extensionCount, availableExtensions.data());
+bool vktools::isDeviceSuitable(VkSurfaceKHR surface, VkPhysicalDevice device) {
+    // 1. Check if all required extensions are supported
+    std::set<std::string> requiredExtensionsSet;
+    for (const char* extension : getRequiredDeviceExtensions(surface)) {
+        requiredExtensionsSet.insert(extension);
+    }
 
-    std::set<std::string> requiredExtensionsSet(consts::DEVICE_EXTENSIONS.begin(), consts::DEVICE_EXTENSIONS.end());
-    for (const auto& extension : availableExtensions) {
-        requiredExtensionsSet.erase(extension.extensionName);
+    for (const auto& extension : getAvailableDeviceExtensions(device)) {
+        requiredExtensionsSet.erase(extension);
     }
 
     if (!requiredExtensionsSet.empty()) {
-        return false;  // Missing required ray tracing extensions
+        return false;  // Missing required extensions
     }
 
     // 2. Check Vulkan API version compatibility
@@ -198,32 +239,97 @@ bool vktools::isDeviceSuitable(VkPhysicalDevice device) {
     vkGetPhysicalDeviceProperties(device, &deviceProperties);
 
     if (deviceProperties.apiVersion < VK_API_VERSION_1_3) {
-        return false;  // This application requires RT version 1.3 or later
+        return false;  // This application requires version 1.3 or later
     }
 
-    // 3. Check for required ray tracing features
-    VkPhysicalDeviceRayTracingPipelineFeaturesKHR rayTracingPipelineFeatures{};
-    rayTracingPipelineFeatures.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_RAY_TRACING_PIPELINE_FEATURES_KHR;
+    // 3. Check for the queue families we need: compute always, graphics and present only when rendering to a window
+    QueueFamilyIndices indices = findQueueFamilies(surface, device);
 
-    VkPhysicalDeviceAccelerationStructureFeaturesKHR accelStructureFeatures{};
-    accelStructureFeatures.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_ACCELERATION_STRUCTURE_FEATURES_KHR;
-    rayTracingPipelineFeatures.pNext = &accelStructureFeatures;
-
-    VkPhysicalDeviceFeatures2 deviceFeatures2{};
-    deviceFeatures2.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_FEATURES_2;
-    deviceFeatures2.pNext = &rayTracingPipelineFeatures;
+    if (!indices.computeFamily.has_value()) {
+        return false;
+    }
 
-    vkGetPhysicalDeviceFeatures2(device, &deviceFeatures2);
+    if (surface != VK_NULL_HANDLE && !indices.isComplete()) {
+        return false;
+    }
 
-    if (!rayTracingPipelineFeatures.rayTracingPipeline || !accelStructureFeatures.accelerationStructure) {
-        return false;  // Device does not support ray tracing
+    // 4. The simulation addresses every resource through a bindless table, see raymarcher::core::BindlessTable
+    if (!queryDeviceCapabilities(surface, device).bindless) {
+        return false;
     }
 
-    // Additional checks like memory limits, queue families, etc., can go here
+    // Optional features (ray tracing, anisotropy, ...) do not make a device unsuitable, see queryDeviceCapabilities()
 
     return true;  // Device satisfies all requirements
 }
 
+bool vktools::DeviceCapabilities::hasExtension(const char* extensionName) const {
+    return std::any_of(enabledExtensions.begin(), enabledExtensions.end(), [extensionName](const char* extension) {
+        return strcmp(extension, extensionName) == 0;
+    });
+}
+
+vktools::DeviceCapabilities vktools::queryDeviceCapabilities(VkSurfaceKHR surface, VkPhysicalDevice device) {
+    DeviceCapabilities capabilities{};
+    capabilities.present = surface != VK_NULL_HANDLE;
+    capabilities.enabledExtensions = getRequiredDeviceExtensions(surface);
+
+    std::set<std::string> availableExtensions = getAvailableDeviceExtensions(device);
+    for (const char* extension : consts::OPTIONAL_DEVICE_EXTENSIONS) {
+        if (availableExtensions.contains(extension)) {
+            capabilities.enabledExtensions.push_back(extension);
+        }
+    }
+
+    // only chain the feature structs of extensions the device actually exposes
+    VkPhysicalDeviceVulkan12Features vulkan12Features{
+        .sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_VULKAN_1_2_FEATURES
+    };
+
+    VkPhysicalDeviceRayTracingPipelineFeaturesKHR rtPipelineFeatures{
+        .sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_RAY_TRACING_PIPELINE_FEATURES_KHR,
+        .pNext = &vulkan12Features
+    };
+
+    VkPhysicalDeviceAccelerationStructureFeaturesKHR asFeatures{
+        .sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_ACCELERATION_STRUCTURE_FEATURES_KHR,
+        .pNext = &rtPipelineFeatures
+    };
+
+    bool rayTracingExtensions = capabilities.hasExtension(VK_KHR_DEFERRED_HOST_OPERATIONS_EXTENSION_NAME)
+            && capabilities.hasExtension(VK_KHR_ACCELERATION_STRUCTURE_EXTENSION_NAME)
+            && capabilities.hasExtension(VK_KHR_RAY_TRACING_PIPELINE_EXTENSION_NAME);
+
+    VkPhysicalDeviceFeatures2 deviceFeatures2{
+        .sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_FEATURES_2,
+        .pNext = rayTracingExtensions ? static_cast<void*>(&asFeatures) : static_cast<void*>(&vulkan12Features)
+    };
+
+    vkGetPhysicalDeviceFeatures2(device, &deviceFeatures2);
+
+    capabilities.runtimeDescriptorArray = vulkan12Features.runtimeDescriptorArray;
+    capabilities.bindless = vulkan12Features.runtimeDescriptorArray && vulkan12Features.descriptorBindingPartiallyBound
+            && vulkan12Features.descriptorBindingSampledImageUpdateAfterBind && vulkan12Features.descriptorBindingStorageImageUpdateAfterBind
+            && vulkan12Features.descriptorBindingStorageBufferUpdateAfterBind && vulkan12Features.descriptorBindingUpdateUnusedWhilePending;
+    capabilities.bufferDeviceAddress = vulkan12Features.bufferDeviceAddress;
+    capabilities.samplerAnisotropy = deviceFeatures2.features.samplerAnisotropy;
+    capabilities.shaderNonSemanticInfo = capabilities.hasExtension(VK_KHR_SHADER_NON_SEMANTIC_INFO_EXTENSION_NAME);
+    capabilities.pushDescriptor = capabilities.hasExtension(VK_KHR_PUSH_DESCRIPTOR_EXTENSION_NAME);
+    capabilities.rayTracing = rayTracingExtensions && capabilities.bufferDeviceAddress
+            && rtPipelineFeatures.rayTracingPipeline && asFeatures.accelerationStructure;
+
+    // the ray tracing extensions are only useful together, so drop all of them if any part is missing
+    if (!capabilities.rayTracing) {
+        std::erase_if(capabilities.enabledExtensions, [](const char* extension) {
+            return strcmp(extension, VK_KHR_DEFERRED_HOST_OPERATIONS_EXTENSION_NAME) == 0
+                || strcmp(extension, VK_KHR_ACCELERATION_STRUCTURE_EXTENSION_NAME) == 0
+                || strcmp(extension, VK_KHR_RAY_TRACING_PIPELINE_EXTENSION_NAME) == 0;
+        });
+    }
+
+    return capabilities;
+}
+
 VkSurfaceFormatKHR chooseSwapSurfaceFormat(const std::vector<VkSurfaceFormatKHR>& availableFormats) {
     for (const auto& availableFormat : availableFormats) {
         if (availableFormat.format == VK_FORMAT_R8G8B8A8_UNORM && availableFormat.colorSpace == VK_COLOR_SPACE_SRGB_NONLINEAR_KHR) {
@@ -262,14 +368,46 @@ VkExtent2D chooseSwapExtent(const VkSurfaceCapabilitiesKHR& capabilities, int wi
     return actualExtent;
 }
 
-vktools::PipelineInfo vktools::createComputePipeline(VkDevice logicalDevice, const ::raymarcher::core::DescriptorSet& descriptorSet, const raymarcher::graphics::Shader& shader) {
-    VkDescriptorSetLayout descriptorLayout = descriptorSet.getLayout();
+VkPipeline vktools::buildComputePipeline(VkDevice logicalDevice, VkPipelineLayout pipelineLayout, const raymarcher::graphics::Shader& shader, raymarcher::core::PipelineCache* pipelineCache) {
+    // compute pipelines must provide exactly one stage feedback entry
+    VkPipelineCreationFeedback pipelineFeedback{};
+    VkPipelineCreationFeedback stageFeedback{};
+    VkPipelineCreationFeedbackCreateInfo feedbackInfo{
+        .sType = VK_STRUCTURE_TYPE_PIPELINE_CREATION_FEEDBACK_CREATE_INFO,
+        .pPipelineCreationFeedback = &pipelineFeedback,
+        .pipelineStageCreationFeedbackCount = 1,
+        .pPipelineStageCreationFeedbacks = &stageFeedback
+    };
+
+    VkComputePipelineCreateInfo pipelineCreateInfo{
+        .sType = VK_STRUCTURE_TYPE_COMPUTE_PIPELINE_CREATE_INFO,
+        .pNext = &feedbackInfo,
+        .stage = shader.pipelineShaderStageCreateInfo(),
+        .layout = pipelineLayout
+    };
+
+    VkPipelineCache cacheHandle = pipelineCache != nullptr ? pipelineCache->getHandle() : VK_NULL_HANDLE;
+    double startTime = raymarcher::tools::Clock::getTime();
+
+    VkPipeline computePipeline;
+    if (vkCreateComputePipelines(logicalDevice, cacheHandle, 1, &pipelineCreateInfo, nullptr, &computePipeline) != VK_SUCCESS) {
+        throw std::runtime_error("Failed to create compute pipeline");
+    }
+
+    if (pipelineCache != nullptr) {
+        pipelineCache->recordCreation(shader.getPath(), raymarcher::tools::Clock::getTime() - startTime, pipelineFeedback);
+    }
+
+    return computePipeline;
+}
+
+VkPipelineLayout vktools::createPipelineLayout(VkDevice logicalDevice, VkDescriptorSetLayout descriptorLayout, const VkPushConstantRange& pushConstantRange) {
     VkPipelineLayoutCreateInfo pipelineLayoutInfo{
         .sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO,
         .setLayoutCount = 1,
         .pSetLayouts = &descriptorLayout,
-        .pushConstantRangeCount = 0,
-        .pPushConstantRanges = VK_NULL_HANDLE
+        .pushConstantRangeCount = 1,
+        .pPushConstantRanges = &pushConstantRange
     };
 
     VkPipelineLayout pipelineLayout;
@@ -277,18 +415,25 @@ vktools::PipelineInfo vktools::createComputePipeline(VkDevice logicalDevice, con
         throw std::runtime_error("Failed to create pipeline layout");
     }
 
-    VkComputePipelineCreateInfo pipelineCreateInfo{
-        .sType = VK_STRUCTURE_TYPE_COMPUTE_PIPELINE_CREATE_INFO,
-        .stage = shader.pipelineShaderStageCreateInfo(),
-        .layout = pipelineLayout
+    return pipelineLayout;
+}
+
+vktools::PipelineInfo vktools::createComputePipeline(VkDevice logicalDevice, const ::raymarcher::core::DescriptorSet& descriptorSet, const raymarcher::graphics::Shader& shader, raymarcher::core::PipelineCache* pipelineCache) {
+    VkDescriptorSetLayout descriptorLayout = descriptorSet.getLayout();
+    VkPipelineLayoutCreateInfo pipelineLayoutInfo{
+        .sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO,
+        .setLayoutCount = 1,
+        .pSetLayouts = &descriptorLayout,
+        .pushConstantRangeCount = 0,
+        .pPushConstantRanges = VK_NULL_HANDLE
     };
 
-    VkPipeline computePipeline;
-    if (vkCreateComputePipelines(logicalDevice, VK_NULL_HANDLE, 1, &pipelineCreateInfo, nullptr, &computePipeline) != VK_SUCCESS) {
-        throw std::runtime_error("Failed to create compute pipeline");
+    VkPipelineLayout pipelineLayout;
+    if (vkCreatePipelineLayout(logicalDevice, &pipelineLayoutInfo, nullptr, &pipelineLayout) != VK_SUCCESS) {
+        throw std::runtime_error("Failed to create pipeline layout");
     }
 
-    return {computePipeline, pipelineLayout};
+    return {buildComputePipeline(logicalDevice, pipelineLayout, shader, pipelineCache), pipelineLayout};
 }
 
 std::vector<VkFramebuffer> vktools::createSwapchainFramebuffers(VkDevice logicalDevice, VkRenderPass renderPass, VkExtent2D extent, const std::vector<VkImageView>& swapchainImageViews) {
@@ -313,7 +458,7 @@ std::vector<VkFramebuffer> vktools::createSwapchainFramebuffers(VkDevice logical
     return swapchainFramebuffers;
 }
 
-vktools::PipelineInfo vktools::createRasterizationPipeline(VkDevice logicalDevice, const raymarcher::core::DescriptorSet &descriptorSet, VkRenderPass renderPass, const raymarcher::graphics::Shader &vertexShader, const raymarcher::graphics::Shader &fragmentShader) {
+vktools::PipelineInfo vktools::createRasterizationPipeline(VkDevice logicalDevice, const raymarcher::core::DescriptorSet &descriptorSet, VkRenderPass renderPass, const raymarcher::graphics::Shader &vertexShader, const raymarcher::graphics::Shader &fragmentShader, raymarcher::core::PipelineCache* pipelineCache) {
     VkPipelineShaderStageCreateInfo shaderStages[] = {
             vertexShader.pipelineShaderStageCreateInfo(),
             fragmentShader.pipelineShaderStageCreateInfo()
@@ -394,8 +539,18 @@ vktools::PipelineInfo vktools::createRasterizationPipeline(VkDevice logicalDevic
         throw std::runtime_error("Failed to create pipeline layout");
     }
 
+    VkPipelineCreationFeedback pipelineFeedback{};
+    VkPipelineCreationFeedback stageFeedbacks[2]{};
+    VkPipelineCreationFeedbackCreateInfo feedbackInfo{
+        .sType = VK_STRUCTURE_TYPE_PIPELINE_CREATION_FEEDBACK_CREATE_INFO,
+        .pPipelineCreationFeedback = &pipelineFeedback,
+        .pipelineStageCreationFeedbackCount = 2,
+        .pPipelineStageCreationFeedbacks = stageFeedbacks
+    };
+
     VkGraphicsPipelineCreateInfo pipelineInfo{};
     pipelineInfo.sType = VK_STRUCTURE_TYPE_GRAPHICS_PIPELINE_CREATE_INFO;
+    pipelineInfo.pNext = &feedbackInfo;
     pipelineInfo.stageCount = 2;
     pipelineInfo.pStages = shaderStages;
     pipelineInfo.pVertexInputState = &vertexInputInfo;
@@ -410,11 +565,18 @@ vktools::PipelineInfo vktools::createRasterizationPipeline(VkDevice logicalDevic
     pipelineInfo.subpass = 0;
     pipelineInfo.basePipelineHandle = VK_NULL_HANDLE;
 
+    VkPipelineCache cacheHandle = pipelineCache != nullptr ? pipelineCache->getHandle() : VK_NULL_HANDLE;
+    double startTime = raymarcher::tools::Clock::getTime();
+
     VkPipeline rasterizationPipeline;
-    if (vkCreateGraphicsPipelines(logicalDevice, VK_NULL_HANDLE, 1, &pipelineInfo, nullptr, &rasterizationPipeline) != VK_SUCCESS) {
+    if (vkCreateGraphicsPipelines(logicalDevice, cacheHandle, 1, &pipelineInfo, nullptr, &rasterizationPipeline) != VK_SUCCESS) {
         throw std::runtime_error("Failed to create graphics pipeline");
     }
 
+    if (pipelineCache != nullptr) {
+        pipelineCache->recordCreation(vertexShader.getPath() + " + " + fragmentShader.getPath(), raymarcher::tools::Clock::getTime() - startTime, pipelineFeedback);
+    }
+
     return {rasterizationPipeline, pipelineLayout};
 }
 
@@ -471,7 +633,7 @@ vktools::SyncObjects vktools::createSyncObjects(VkDevice logicalDevice) {
     return syncObjects;
 }
 
-VkSampler vktools::createSampler(VkDevice logicalDevice) {
+VkSampler vktools::createSampler(VkDevice logicalDevice, bool anisotropy) {
     VkSamplerCreateInfo samplerInfo{
         .sType = VK_STRUCTURE_TYPE_SAMPLER_CREATE_INFO,
         .magFilter = VK_FILTER_LINEAR,
@@ -480,8 +642,8 @@ VkSampler vktools::createSampler(VkDevice logicalDevice) {
         .addressModeU = VK_SAMPLER_ADDRESS_MODE_REPEAT,
         .addressModeV = VK_SAMPLER_ADDRESS_MODE_REPEAT,
         .addressModeW = VK_SAMPLER_ADDRESS_MODE_REPEAT,
-        .anisotropyEnable = VK_TRUE,
-        .maxAnisotropy = 16.0f,
+        .anisotropyEnable = anisotropy ? VK_TRUE : VK_FALSE,
+        .maxAnisotropy = anisotropy ? 16.0f : 1.0f,
         .compareEnable = VK_FALSE,
         .compareOp = VK_COMPARE_OP_ALWAYS,
         .borderColor = VK_BORDER_COLOR_INT_OPAQUE_BLACK,
@@ -496,13 +658,11 @@ VkSampler vktools::createSampler(VkDevice logicalDevice) {
     return sampler;
 }
 
-VkCommandPool vktools::createCommandPool(VkPhysicalDevice physicalDevice, VkDevice logicalDevice, VkSurfaceKHR surface) {
-    QueueFamilyIndices queueFamilyIndices = findQueueFamilies(surface, physicalDevice);
-
+VkCommandPool vktools::createCommandPool(VkDevice logicalDevice, uint32_t queueFamilyIndex) {
     VkCommandPoolCreateInfo poolInfo{
         .sType = VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO,
         .flags = VK_COMMAND_POOL_CREATE_RESET_COMMAND_BUFFER_BIT,
-        .queueFamilyIndex = queueFamilyIndices.graphicsFamily.value()
+        .queueFamilyIndex = queueFamilyIndex
     };
 
     VkCommandPool commandPool;
@@ -547,7 +707,7 @@ std::vector<VkImageView> vktools::createSwapchainImageViews(VkDevice logicalDevi
     return swapchainImageViews;
 }
 
-vktools::SwapchainObjects vktools::createSwapchain(VkSurfaceKHR surface, VkPhysicalDevice physicalDevice, VkDevice logicalDevice, int windowWidth, int windowHeight) {
+vktools::SwapchainObjects vktools::createSwapchain(VkSurfaceKHR surface, VkPhysicalDevice physicalDevice, VkDevice logicalDevice, int windowWidth, int windowHeight, VkSwapchainKHR oldSwapchain) {
     vktools::SwapChainSupportDetails swapChainSupport = vktools::querySwapChainSupport(surface, physicalDevice);
 
     VkSurfaceFormatKHR surfaceFormat = chooseSwapSurfaceFormat(swapChainSupport.formats);
@@ -577,7 +737,7 @@ vktools::SwapchainObjects vktools::createSwapchain(VkSurfaceKHR surface, VkPhysi
         .compositeAlpha = VK_COMPOSITE_ALPHA_OPAQUE_BIT_KHR,
         .presentMode = presentMode,
         .clipped = VK_TRUE,
-        .oldSwapchain = VK_NULL_HANDLE
+        .oldSwapchain = oldSwapchain  // lets the driver reuse resources when recreating after a resize
     };
 
     if (indices.graphicsFamily != indices.presentFamily) {
@@ -603,11 +763,23 @@ vktools::SwapchainObjects vktools::createSwapchain(VkSurfaceKHR surface, VkPhysi
     return swapchainObjects;
 }
 
-VkDevice vktools::createLogicalDevice(VkSurfaceKHR surface, VkPhysicalDevice physicalDevice) {
+VkDevice vktools::createLogicalDevice(VkSurfaceKHR surface, VkPhysicalDevice physicalDevice, const DeviceCapabilities& capabilities) {
     QueueFamilyIndices indices = vktools::findQueueFamilies(surface, physicalDevice);
 
     std::vector<VkDeviceQueueCreateInfo> queueCreateInfos;
-    std::set<uint32_t> uniqueQueueFamilies = {indices.graphicsFamily.value(), indices.presentFamily.value()};
+    std::set<uint32_t> uniqueQueueFamilies = {indices.computeFamily.value()};
+
+    if (indices.graphicsFamily.has_value()) {
+        uniqueQueueFamilies.insert(indices.graphicsFamily.value());
+    }
+
+    if (indices.presentFamily.has_value()) {
+        uniqueQueueFamilies.insert(indices.presentFamily.value());
+    }
+
+    if (indices.asyncComputeFamily.has_value()) {
+        uniqueQueueFamilies.insert(indices.asyncComputeFamily.value());
+    }
 
     float queuePriority = 1;
 
@@ -627,44 +799,44 @@ VkDevice vktools::createLogicalDevice(VkSurfaceKHR surface, VkPhysicalDevice phy
 //        .sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_RAY_TRACING_VALIDATION_FEATURES_NV
 //    };
 
+    // only enable what queryDeviceCapabilities() found, so devices without these features can still be created
+    // barriers are recorded with vkCmdPipelineBarrier2, which is core in 1.3 but still has to be enabled
+    VkPhysicalDeviceVulkan13Features vulkan13Features{
+        .sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_VULKAN_1_3_FEATURES,
+        .synchronization2 = VK_TRUE
+    };
+
     VkPhysicalDeviceVulkan12Features vulkan12Features{
         .sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_VULKAN_1_2_FEATURES,
-        .runtimeDescriptorArray = VK_TRUE,
-        .bufferDeviceAddress = VK_TRUE,
+        .pNext = &vulkan13Features,
+        .descriptorBindingSampledImageUpdateAfterBind = capabilities.bindless,
+        .descriptorBindingStorageImageUpdateAfterBind = capabilities.bindless,
+        .descriptorBindingStorageBufferUpdateAfterBind = capabilities.bindless,
+        .descriptorBindingUpdateUnusedWhilePending = capabilities.bindless,
+        .descriptorBindingPartiallyBound = capabilities.bindless,
+        .runtimeDescriptorArray = capabilities.runtimeDescriptorArray,
+        .bufferDeviceAddress = capabilities.bufferDeviceAddress,
 //        .pNext = &validationFeatures
     };
 
-    // Commented out since the VulkanPhysicalDeviceVulkan12Features covers this
-//    VkPhysicalDeviceBufferDeviceAddressFeatures addressFeatures{
-//        .sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_BUFFER_DEVICE_ADDRESS_FEATURES,
-//        .pNext = &vulkan12Features
-//    };
-
     VkPhysicalDeviceRayTracingPipelineFeaturesKHR rtPipelineFeatures{
             .sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_RAY_TRACING_PIPELINE_FEATURES_KHR,
-            .pNext = &vulkan12Features
+            .pNext = &vulkan12Features,
+            .rayTracingPipeline = VK_TRUE
     };
 
     VkPhysicalDeviceAccelerationStructureFeaturesKHR asFeatures{
         .sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_ACCELERATION_STRUCTURE_FEATURES_KHR,
-        .pNext = &rtPipelineFeatures
+        .pNext = &rtPipelineFeatures,
+        .accelerationStructure = VK_TRUE
     };
 
     VkPhysicalDeviceFeatures2 deviceFeatures2{
         .sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_FEATURES_2,
-        .pNext = &asFeatures
+        .pNext = capabilities.rayTracing ? static_cast<void*>(&asFeatures) : static_cast<void*>(&vulkan12Features)
     };
 
-    vkGetPhysicalDeviceFeatures2(physicalDevice, &deviceFeatures2);
-
-    // Enable required ray tracing features
-    if (!rtPipelineFeatures.rayTracingPipeline) {
-        throw std::runtime_error("Ray tracing pipeline feature is not supported by the physical device.");
-    }
-
-    if (!asFeatures.accelerationStructure) {
-        throw std::runtime_error("Acceleration structure feature is not supported by the physical device.");
-    }
+    deviceFeatures2.features.samplerAnisotropy = capabilities.samplerAnisotropy;
 
 //    if (!validationFeatures.rayTracingValidation) {
 //        throw std::runtime_error("Ray tracing validation not supported");
@@ -675,8 +847,8 @@ VkDevice vktools::createLogicalDevice(VkSurfaceKHR surface, VkPhysicalDevice phy
         .pNext = &deviceFeatures2,
         .queueCreateInfoCount = static_cast<uint32_t>(queueCreateInfos.size()),
         .pQueueCreateInfos = queueCreateInfos.data(),
-        .enabledExtensionCount = static_cast<uint32_t>(consts::DEVICE_EXTENSIONS.size()),
-        .ppEnabledExtensionNames = consts::DEVICE_EXTENSIONS.data(),
+        .enabledExtensionCount = static_cast<uint32_t>(capabilities.enabledExtensions.size()),
+        .ppEnabledExtensionNames = capabilities.enabledExtensions.data(),
         .pEnabledFeatures = nullptr  // use the pNext thing instead
     };
 
@@ -693,7 +865,7 @@ VkDevice vktools::createLogicalDevice(VkSurfaceKHR surface, VkPhysicalDevice phy
     return device;
 }
 
-VkPhysicalDevice vktools::pickPhysicalDevice(VkInstance instance) {
+VkPhysicalDevice vktools::pickPhysicalDevice(VkInstance instance, VkSurfaceKHR surface) {
     uint32_t deviceCount = 0;
     vkEnumeratePhysicalDevices(instance, &deviceCount, nullptr);
 
@@ -701,9 +873,9 @@ VkPhysicalDevice vktools::pickPhysicalDevice(VkInstance instance) {
     vkEnumeratePhysicalDevices(instance, &deviceCount, devices.data());
 
     VkPhysicalDevice highestScoreDevice = VK_NULL_HANDLE;
-    uint32_t highestScore = 0;
+    uint64_t highestScore = 0;
     for (VkPhysicalDevice device : devices) {
-        if (!isDeviceSuitable(device)) {
+        if (!isDeviceSuitable(surface, device)) {
             continue;
         }
 
@@ -713,14 +885,15 @@ VkPhysicalDevice vktools::pickPhysicalDevice(VkInstance instance) {
         vkGetPhysicalDeviceProperties(device, &deviceProperties);
 
         // VRAM is an indicator of a GPU's strength
-        uint32_t score = vktools::getDeviceLocalMemory(device);
+        uint64_t score = vktools::getDeviceLocalMemory(device);
 
         // favor discrete GPUs
         if (deviceProperties.deviceType == VK_PHYSICAL_DEVICE_TYPE_DISCRETE_GPU) {
             score *= 2;
         }
 
-        if (score > highestScore) {
+        // CPU implementations may report no device-local memory at all, so always accept the first suitable device
+        if (highestScoreDevice == VK_NULL_HANDLE || score > highestScore) {
             highestScore = score;
             highestScoreDevice = device;
         }
@@ -767,7 +940,7 @@ std::optional<VkDebugUtilsMessengerEXT> vktools::createDebugMessenger(VkInstance
     return debugMessenger;
 }
 
-VkInstance vktools::createInstance() {
+VkInstance vktools::createInstance(bool headless) {
     if (consts::ENABLE_VALIDATION_LAYERS && !hasValidationLayerSupport()) {
         throw std::runtime_error("Validation layers requested but not available");
     }
@@ -782,7 +955,7 @@ VkInstance vktools::createInstance() {
     };
 
     // 1) Get the platform/GLFW extensions…
-    std::vector<const char*> extensions = getRequiredExtensions();
+    std::vector<const char*> extensions = getRequiredExtensions(headless);
 
     // 2) Enable portability-enumeration extension
     extensions.push_back(VK_KHR_PORTABILITY_ENUMERATION_EXTENSION_NAME);
@@ -15,12 +15,19 @@
 #include "../core/DescriptorSet.h"
 #include "../core/PushConstants.h"
 #include "../core/Buffer.h"
+#include "../core/PipelineCache.h"
 
 namespace vktools {
     struct QueueFamilyIndices {
         std::optional<uint32_t> graphicsFamily;
         std::optional<uint32_t> presentFamily;
 
+        // the graphics family when the device has one, otherwise any compute-capable family
+        std::optional<uint32_t> computeFamily;
+
+        // a compute family without graphics support. work submitted here can overlap with the graphics queue
+        std::optional<uint32_t> asyncComputeFamily;
+
         [[nodiscard]] bool isComplete() const;
     };
 
@@ -31,7 +38,7 @@ namespace vktools {
     };
 
     struct SwapchainObjects {
-        VkSwapchainKHR swapchain;
+        VkSwapchainKHR swapchain = VK_NULL_HANDLE;
         std::vector<VkImage> swapchainImages;
         VkFormat swapchainImageFormat;
         VkExtent2D swapchainExtent;
@@ -45,13 +52,33 @@ namespace vktools {
     };
 
     struct PipelineInfo {
-        VkPipeline pipeline;
-        VkPipelineLayout pipelineLayout;
+        VkPipeline pipeline = VK_NULL_HANDLE;
+        VkPipelineLayout pipelineLayout = VK_NULL_HANDLE;
     };
 
     struct SyncObjects {
-        VkSemaphore imageAvailableSemaphore;
-        VkSemaphore renderFinishedSemaphore;
+        VkSemaphore imageAvailableSemaphore = VK_NULL_HANDLE;
+        VkSemaphore renderFinishedSemaphore = VK_NULL_HANDLE;
+    };
+
+    /**
+     * What the picked device can do beyond the required core set. Filled by queryDeviceCapabilities() before the
+     * logical device is created, and everything in here is enabled on the logical device. bindless is the exception,
+     * isDeviceSuitable() requires it, so it is always set on the picked device.
+     */
+    struct DeviceCapabilities {
+        bool present = false;
+        bool rayTracing = false;  // acceleration structures + ray tracing pipelines + deferred host operations
+        bool shaderNonSemanticInfo = false;
+        bool runtimeDescriptorArray = false;
+        bool bindless = false;  // required. partially bound, update after bind arrays of images and storage buffers, see BindlessTable
+        bool bufferDeviceAddress = false;
+        bool samplerAnisotropy = false;
+        bool pushDescriptor = false;
+
+        std::vector<const char*> enabledExtensions;
+
+        [[nodiscard]] bool hasExtension(const char* extensionName) const;
     };
 
     struct AccStructureInfo {
@@ -75,7 +102,8 @@ namespace vktools {
     VkResult createDebugUtilsMessengerEXT(VkInstance instance, const VkDebugUtilsMessengerCreateInfoEXT* pCreateInfo, const VkAllocationCallbacks* pAllocator, VkDebugUtilsMessengerEXT* pDebugMessenger);
     void DestroyDebugUtilsMessengerEXT(VkInstance instance, VkDebugUtilsMessengerEXT debugMessenger, const VkAllocationCallbacks* pAllocator);
     uint64_t getDeviceLocalMemory(VkPhysicalDevice device);
-    bool isDeviceSuitable(VkPhysicalDevice device);
+    bool isDeviceSuitable(VkSurfaceKHR surface, VkPhysicalDevice device);
+    DeviceCapabilities queryDeviceCapabilities(VkSurfaceKHR surface, VkPhysicalDevice device);
 
     template <typename T>
     void loadVkFunc(VkDevice logicalDevice, const char* funcName, T& funcPtr) {
@@ -85,8 +113,19 @@ namespace vktools {
         }
     }
 
+    /**
+     * Create a compute pipeline for an existing layout, going through the pipeline cache when one is given.
+     * Creation time and cache hit/miss feedback are recorded in the cache.
+     */
+    VkPipeline buildComputePipeline(VkDevice logicalDevice, VkPipelineLayout pipelineLayout, const raymarcher::graphics::Shader& shader, raymarcher::core::PipelineCache* pipelineCache);
+
+    /**
+     * A layout with one descriptor set and one push constant range, for pipelines that share both.
+     */
+    VkPipelineLayout createPipelineLayout(VkDevice logicalDevice, VkDescriptorSetLayout descriptorLayout, const VkPushConstantRange& pushConstantRange);
+
     template <typename T>
-    PipelineInfo createComputePipeline(VkDevice logicalDevice, const::raymarcher::core::DescriptorSet& descriptorSet, const raymarcher::graphics::Shader& shader, const raymarcher::core::PushConstants<T>& pushConstants) {
+    PipelineInfo createComputePipeline(VkDevice logicalDevice, const::raymarcher::core::DescriptorSet& descriptorSet, const raymarcher::graphics::Shader& shader, const raymarcher::core::PushConstants<T>& pushConstants, raymarcher::core::PipelineCache* pipelineCache = nullptr) {
         VkDescriptorSetLayout descriptorLayout = descriptorSet.getLayout();
         VkPushConstantRange range = pushConstants.getRange();
         VkPipelineLayoutCreateInfo pipelineLayoutInfo{
@@ -102,37 +141,26 @@ namespace vktools {
             throw std::runtime_error("Failed to create pipeline layout");
         }
 
-        VkComputePipelineCreateInfo pipelineCreateInfo{
-                .sType = VK_STRUCTURE_TYPE_COMPUTE_PIPELINE_CREATE_INFO,
-                .stage = shader.pipelineShaderStageCreateInfo(),
-                .layout = pipelineLayout
-        };
-
-        VkPipeline computePipeline;
-        if (vkCreateComputePipelines(logicalDevice, VK_NULL_HANDLE, 1, &pipelineCreateInfo, nullptr, &computePipeline) != VK_SUCCESS) {
-            throw std::runtime_error("Failed to create compute pipeline");
-        }
-
-        return {computePipeline, pipelineLayout};
+        return {buildComputePipeline(logicalDevice, pipelineLayout, shader, pipelineCache), pipelineLayout};
     }
 
-    PipelineInfo createComputePipeline(VkDevice logicalDevice, const::raymarcher::core::DescriptorSet& descriptorSet, const raymarcher::graphics::Shader& shader);
+    PipelineInfo createComputePipeline(VkDevice logicalDevice, const::raymarcher::core::DescriptorSet& descriptorSet, const raymarcher::graphics::Shader& shader, raymarcher::core::PipelineCache* pipelineCache = nullptr);
 
     std::vector<VkFramebuffer> createSwapchainFramebuffers(VkDevice logicalDevice, VkRenderPass renderPass, VkExtent2D extent, const std::vector<VkImageView>& swapchainImageViews);
-    PipelineInfo createRasterizationPipeline(VkDevice logicalDevice, const raymarcher::core::DescriptorSet& descriptorSet, VkRenderPass renderPass, const raymarcher::graphics::Shader& vertexShader, const raymarcher::graphics::Shader& fragmentShader);
+    PipelineInfo createRasterizationPipeline(VkDevice logicalDevice, const raymarcher::core::DescriptorSet& descriptorSet, VkRenderPass renderPass, const raymarcher::graphics::Shader& vertexShader, const raymarcher::graphics::Shader& fragmentShader, raymarcher::core::PipelineCache* pipelineCache = nullptr);
     VkRenderPass createRenderPass(VkDevice logicalDevice, VkFormat swapchainImageFormat);
 
     SyncObjects createSyncObjects(VkDevice logicalDevice);
-    VkSampler createSampler(VkDevice logicalDevice);
+    VkSampler createSampler(VkDevice logicalDevice, bool anisotropy);
 
-    VkCommandPool createCommandPool(VkPhysicalDevice physicalDevice, VkDevice logicalDevice, VkSurfaceKHR surface);
+    VkCommandPool createCommandPool(VkDevice logicalDevice, uint32_t queueFamilyIndex);
     std::vector<VkImageView> createSwapchainImageViews(VkDevice logicalDevice, VkFormat swapchainImageFormat, std::vector<VkImage> swapchainImages);
-    SwapchainObjects createSwapchain(VkSurfaceKHR surface, VkPhysicalDevice physicalDevice, VkDevice logicalDevice, int windowWidth, int windowHeight);
-    VkDevice createLogicalDevice(VkSurfaceKHR surface, VkPhysicalDevice physicalDevice);
-    VkPhysicalDevice pickPhysicalDevice(VkInstance instance);
+    SwapchainObjects createSwapchain(VkSurfaceKHR surface, VkPhysicalDevice physicalDevice, VkDevice logicalDevice, int windowWidth, int windowHeight, VkSwapchainKHR oldSwapchain = VK_NULL_HANDLE);
+    VkDevice createLogicalDevice(VkSurfaceKHR surface, VkPhysicalDevice physicalDevice, const DeviceCapabilities& capabilities);
+    VkPhysicalDevice pickPhysicalDevice(VkInstance instance, VkSurfaceKHR surface);
     VkSurfaceKHR createSurface(VkInstance instance, GLFWwindow* window);
     std::optional<VkDebugUtilsMessengerEXT> createDebugMessenger(VkInstance instance);
-    VkInstance createInstance();
+    VkInstance createInstance(bool headless = false);
 }
 
 
@@ -8,11 +8,12 @@ raymarcher::window::Window::Window(int width, int height) {
     }
 
     glfwWindowHint(GLFW_CLIENT_API, GLFW_NO_API);
-    glfwWindowHint(GLFW_RESIZABLE, GLFW_FALSE);
+    glfwWindowHint(GLFW_RESIZABLE, GLFW_TRUE);
 
     glfwWindow = glfwCreateWindow(width, height, "Raymarcher", nullptr, nullptr);
 
-    glfwGetWindowSize(glfwWindow, &this->width, &this->height);
+    // the swapchain is sized in pixels, which differs from the window size on high-DPI displays
+    glfwGetFramebufferSize(glfwWindow, &this->width, &this->height);
 }
 
 int raymarcher::window::Window::getWidth() const {
@@ -42,6 +43,19 @@ bool raymarcher::window::Window::isMinimized() const {
     return fbWidth == 0 || fbHeight == 0;
 }
 
+bool raymarcher::window::Window::pollResized() {
+    int fbWidth, fbHeight;
+    glfwGetFramebufferSize(glfwWindow, &fbWidth, &fbHeight);
+
+    if (fbWidth == width && fbHeight == height) {
+        return false;
+    }
+
+    width = fbWidth;
+    height = fbHeight;
+    return true;
+}
+
 bool raymarcher::window::Window::keyPressed(int glfwKey) const {
     return glfwGetKey(glfwWindow, glfwKey) == GLFW_PRESS;
 }
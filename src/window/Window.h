@@ -18,6 +18,11 @@ namespace raymarcher::window {
         [[nodiscard]] GLFWwindow* getGlfwWindow() const;
 
         [[nodiscard]] bool isMinimized() const;
+
+        /**
+         * Whether the framebuffer size changed since the last call. Updates getWidth() and getHeight().
+         */
+        bool pollResized();
         [[nodiscard]] bool shouldClose() const;
 
         [[nodiscard]] bool keyPressed(int glfwKey) const;